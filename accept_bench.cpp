@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Benchmark of the TCP-server accept path in a reconnect storm:
+    accept rate and connect-to-greeting latency for a single listener
+    versus SO_REUSEPORT shards (headless, loopback)
+                                                   ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "led_core.h"
+#include "net_shards.h"
+#include "pult_queue.h"
+#include "tcp_srv.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Connects and waits for the greeting of the session; -1.0 on failure.
+double connect_once(int port)
+{
+    auto t0{ Clock::now() };
+    int s{ socket(AF_INET, SOCK_STREAM, 0) };
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if(connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(s);
+        return -1.0;
+    }
+    // A connection lost in a full accept queue must not hang the bench:
+    timeval tv{ 5, 0 };
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    char buf[256];
+    size_t got{ 0 };
+    while(!memchr(buf, '\n', got) && got < sizeof(buf)) {
+        ssize_t n{ read(s, buf + got, sizeof(buf) - got) };
+        if(n <= 0) { break; }
+        got += static_cast<size_t>(n);
+    }
+    double us{ std::chrono::duration<double, std::micro>(
+                   Clock::now() - t0).count() };
+    close(s);
+    return memchr(buf, '\n', got) ? us : -1.0;
+}
+
+void run(SrvLogger &logger, int shards, int clients, int total, int port)
+{
+    LEDCore core;
+    Selector renderSel(&logger);
+    PultQueue commands(&renderSel);
+    NetShards network(&core, &logger, &commands, port, shards);
+    network.Start();
+
+    std::atomic<int> next{ 0 };
+    std::vector<std::vector<double>> lat(static_cast<size_t>(clients));
+    std::vector<std::thread> threads;
+    auto start{ Clock::now() };
+    for(int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            auto &mine{ lat[static_cast<size_t>(c)] };
+            while(next.fetch_add(1) < total) {
+                mine.push_back(connect_once(port));
+            }
+        });
+    }
+    for(auto &t : threads) { t.join(); }
+    double wall{ std::chrono::duration<double>(Clock::now() - start).count() };
+    network.Join();
+
+    std::vector<double> all;
+    int failed{ 0 };
+    for(auto &v : lat) {
+        for(double us : v) {
+            if(us < 0.0) { ++failed; } else { all.push_back(us); }
+        }
+    }
+    std::sort(all.begin(), all.end());
+    auto pct{ [&all](double p) {
+        return all.empty() ? 0.0 : 
+               all[static_cast<size_t>(p * static_cast<double>(all.size() - 1))];
+    } };
+    printf("%2d listener(s), %3d clients: %8.0f accepts/s, "
+           "p50 %8.1f us, p99 %8.1f us, max %8.1f us, %d failed\n",
+           shards, clients, static_cast<double>(all.size()) / wall,
+           pct(0.5), pct(0.99), all.empty() ? 0.0 : all.back(), failed);
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    // Usage: le365_accept_bench [connections [shards]]
+    int total{ argc > 1 ? atoi(argv[1]) : 4000 };
+    int most{ argc > 2 ? atoi(argv[2]) : 
+                         static_cast<int>(std::thread::hardware_concurrency()) };
+    most = std::clamp(most, 2, le365const::tcp_max_shards);
+    // Connects are logged to std::clog, the results go to std::cout:
+    SrvLogger logger("/dev/null");
+    // Below the ephemeral range: thousands of client ports in TIME-WAIT
+    // must not collide with the listeners of the next run.
+    int port{ 29100 };
+    for(int clients : { 16, 64 }) {
+        run(logger, 1, clients, total, port++);
+        run(logger, most, clients, total, port++);
+    }
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
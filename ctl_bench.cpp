@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Benchmark of the command round trip on loopback TCP versus the Unix
+    socket: "x" is answered by the network thread, "up" goes through the
+    render thread's PultQueue and MainLoop and back (headless_srv.h)
+                                                 ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "headless_srv.h"
+
+#include <netinet/tcp.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+int connect_tcp(int port)
+{
+    int s{ socket(AF_INET, SOCK_STREAM, 0) };
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if(connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(s);
+        return -1;
+    }
+    int opt{ 1 };
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    return s;
+}
+
+int connect_local(const char *path)
+{
+    int s{ socket(AF_UNIX, SOCK_STREAM, 0) };
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if(connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+// Reads up to the prompt that ends every answer:
+bool read_answer(int s)
+{
+    char buf[512];
+    size_t got{ 0 };
+    const std::string_view prompt{ "CLI: " };
+    for(;;) {
+        ssize_t n{ read(s, buf + got, sizeof(buf) - got) };
+        if(n <= 0) { return false; }
+        got += static_cast<size_t>(n);
+        if(got >= prompt.size() &&
+           std::string_view(buf + got - prompt.size(), prompt.size()) ==
+           prompt) { return true; }
+        if(got == sizeof(buf)) { got = 0; }
+    }
+}
+
+void measure(const char *name, int s, const char *cmd, int rounds)
+{
+    std::vector<double> lat;
+    lat.reserve(static_cast<size_t>(rounds));
+    size_t len{ strlen(cmd) };
+    for(int i = 0; i < rounds; ++i) {
+        auto t0{ Clock::now() };
+        if(write(s, cmd, len) != static_cast<ssize_t>(len) ||
+           !read_answer(s)) {
+            printf("%-6s %-4.*s: failed\n", name,
+                   static_cast<int>(len - 1), cmd);
+            return;
+        }
+        lat.push_back(std::chrono::duration<double, std::micro>(
+                          Clock::now() - t0).count());
+    }
+    std::sort(lat.begin(), lat.end());
+    double sum{ 0.0 };
+    for(double us : lat) { sum += us; }
+    auto pct{ [&lat](double p) {
+        return lat[static_cast<size_t>(p * static_cast<double>(lat.size() - 1))];
+    } };
+    printf("%-6s %-4.*s: mean %7.1f us, p50 %7.1f us, p99 %7.1f us, "
+           "max %8.1f us\n", name, static_cast<int>(len - 1), cmd,
+           sum / static_cast<double>(lat.size()), pct(0.5), pct(0.99),
+           lat.back());
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    // Usage: le365_ctl_bench [round trips]
+    int rounds{ argc > 1 ? std::max(atoi(argv[1]), 1) : 20000 };
+    const char *path{ "/tmp/le365_ctl_bench.sock" };
+    // The results go to std::cout, the server logs nothing there:
+    auto server{ std::make_unique<HeadlessServer>(29200, 1, path, false) };
+
+    int tcp{ connect_tcp(29200) };
+    int local{ connect_local(path) };
+    if(tcp == -1 || local == -1 || !read_answer(tcp) || !read_answer(local)) {
+        printf("Can't connect\n");
+    } else {
+        for(const char *cmd : { "x\n", "up\n" }) {
+            measure("tcp", tcp, cmd, rounds);
+            measure("unix", local, cmd, rounds);
+        }
+    }
+    if(tcp != -1) { close(tcp); }
+    if(local != -1) { close(local); }
+    server.reset();
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Decoder of the binary event log (see event_log.h): prints the records
+    in the order they were taken, in the text format of the server log
+                                                                      ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "event_log.h"
+#include "srv_logger.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <utility>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Peer of a connect record, as the server log names it:
+std::string peer_name(const EventRecord &r)
+{
+    char name[ 32 ];
+    if(r.event == ev_connect) {
+        in_addr a{};
+        a.s_addr = r.arg;
+        char ip[ INET_ADDRSTRLEN ];
+        inet_ntop(AF_INET, &a, ip, sizeof(ip));
+        snprintf(name, sizeof(name), "%s:%u", ip,
+                 static_cast<unsigned>(r.arg2));
+    } else {
+        snprintf(name, sizeof(name), "local:%u",
+                 static_cast<unsigned>(r.arg));
+    }
+    return name;
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    // Usage: le365_event_decode [file]
+    std::string file{ argc > 1 ? argv[1] : le365evt::default_file };
+    int fd{ open(file.c_str(), O_RDONLY | O_CLOEXEC) };
+    struct stat st{};
+    if(fd == -1 || fstat(fd, &st) == -1) {
+        perror(file.c_str());
+        return 1;
+    }
+    auto size{ static_cast<size_t>(st.st_size) };
+    void *p{ size >= sizeof(EventLogHeader) ?
+             mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED };
+    close(fd);
+    if(p == MAP_FAILED) {
+        fprintf(stderr, "%s: not an event log\n", file.c_str());
+        return 1;
+    }
+    auto hdr{ static_cast<const EventLogHeader*>(p) };
+    if(hdr->magic != le365evt::magic || hdr->version != le365evt::version ||
+       hdr->recordSize != sizeof(EventRecord) ||
+       hdr->headerSize + hdr->capacity * sizeof(EventRecord) > size) {
+        fprintf(stderr, "%s: not an event log of this version\n",
+                file.c_str());
+        munmap(p, size);
+        return 1;
+    }
+    auto first{ reinterpret_cast<const EventRecord*>(
+                    static_cast<const char*>(p) + hdr->headerSize) };
+    // Slots of the ring in the order they were taken, the empty and the
+    // half-written ones (a crash) are skipped:
+    std::vector<const EventRecord*> order;
+    order.reserve(static_cast<size_t>(hdr->capacity));
+    for(uint64_t i = 0; i < hdr->capacity; ++i) {
+        if(first[i].seq != 0) { order.push_back(first + i); }
+    }
+    std::sort(order.begin(), order.end(),
+              [](const EventRecord *a, const EventRecord *b) {
+                  return a->seq < b->seq;
+              });
+    uint64_t taken{ hdr->next.load(std::memory_order_relaxed) };
+    if(taken > order.size()) {
+        fprintf(stderr, "%llu older events were overwritten or lost\n",
+                static_cast<unsigned long long>(taken - order.size()));
+    }
+
+    std::map<std::pair<uint16_t, uint64_t>, std::string> peers;
+    std::string line;
+    for(const EventRecord *r : order) {
+        auto key{ std::make_pair(r->source, r->session) };
+        if(r->event == ev_connect || r->event == ev_connect_local) {
+            peers[key] = peer_name(*r);
+        }
+        auto peer{ peers.find(key) };
+        line.clear();
+        log_stamp(event_usec(*hdr, *r), line);
+        line += event_message(*r, peer != peers.end() ? peer->second : "");
+        line += '\n';
+        fwrite(line.data(), 1, line.size(), stdout);
+    }
+    munmap(p, size);
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
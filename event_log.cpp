@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Binary event log in a memory-mapped file
+                                            ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "event_log.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <new>
+#include <system_error>
+#include <thread>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: EventLog ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+EventLog::EventLog(const char *fileName, size_t count)
+    : hdr(nullptr), records(nullptr), mask(0), mapSize(0), calibrated(0)
+{
+    size_t capacity{ 1 };
+    while(capacity < count) { capacity <<= 1; }
+    mapSize = sizeof(EventLogHeader) + capacity * sizeof(EventRecord);
+    int fd{ open(fileName, O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644) };
+    if(fd == -1) [[unlikely]] {
+        throw std::system_error(errno, std::generic_category(),
+                                "EventLog in: open()");
+    }
+    // Blocks are reserved now, a full disk can't fault a writer later:
+    int err{ posix_fallocate(fd, 0, static_cast<off_t>(mapSize)) };
+    if(err != 0) [[unlikely]] {
+        close(fd);
+        throw std::system_error(err, std::generic_category(),
+                                "EventLog in: posix_fallocate()");
+    }
+    // Prefaulted, the first record of a page costs no page fault:
+    void *p{ mmap(nullptr, mapSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, 0) };
+    close(fd);
+    if(p == MAP_FAILED) [[unlikely]] {
+        throw std::system_error(errno, std::generic_category(),
+                                "EventLog in: mmap()");
+    }
+    hdr = new(p) EventLogHeader{};
+    hdr->magic = le365evt::magic;
+    hdr->version = le365evt::version;
+    hdr->headerSize = sizeof(EventLogHeader);
+    hdr->recordSize = sizeof(EventRecord);
+    hdr->capacity = capacity;
+    records = reinterpret_cast<EventRecord*>(static_cast<char*>(p) +
+                                             sizeof(EventLogHeader));
+    mask = capacity - 1;
+    // A first measure of the ticks' rate, refined by Calibrate():
+    hdr->baseUsec = NowUsec();
+    hdr->baseTicks = event_ticks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    Calibrate();
+}
+
+EventLog::~EventLog()
+{
+    msync(hdr, mapSize, MS_ASYNC);
+    munmap(hdr, mapSize);
+}
+
+int64_t EventLog::NowUsec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void EventLog::Calibrate()
+{
+    // The longer the base, the finer the rate:
+    uint64_t t{ event_ticks() };
+    if(calibrated && 
+       static_cast<double>(t - calibrated) < hdr->ticksPerUsec * 1e6) { 
+        return; 
+    }
+    int64_t us{ NowUsec() - hdr->baseUsec };
+    if(us > 0) {
+        hdr->ticksPerUsec = static_cast<double>(t - hdr->baseTicks) / 
+                            static_cast<double>(us);
+    }
+    calibrated = t;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int64_t event_usec(const EventLogHeader &h, const EventRecord &r)
+{
+    // Ticks taken before the base are possible on other cores:
+    double dt{ static_cast<double>(static_cast<int64_t>(r.ticks - 
+                                                        h.baseTicks)) };
+    return h.baseUsec + static_cast<int64_t>(std::llround(dt / 
+                                                          h.ticksPerUsec));
+}
+
+std::string event_message(const EventRecord &r, const std::string &peer)
+{
+    char who[ 48 ];
+    if(!peer.empty()) {
+        snprintf(who, sizeof(who), "%s", peer.c_str());
+    } else {
+        snprintf(who, sizeof(who), "session %u.%llx",
+                 static_cast<unsigned>(r.source),
+                 static_cast<unsigned long long>(r.session));
+    }
+    char msg[ 128 ];
+    switch(r.event) {
+        case ev_connect:
+        case ev_connect_local:
+            snprintf(msg, sizeof(msg), "%s has connected", who);
+            break;
+        case ev_disconnect:
+            if(r.arg2) {
+                snprintf(msg, sizeof(msg),
+                         "%s has disconnected%s, throttled %u times", who,
+                         r.arg ? " (reset)" : "",
+                         static_cast<unsigned>(r.arg2));
+            } else {
+                snprintf(msg, sizeof(msg), "%s has disconnected%s", who,
+                         r.arg ? " (reset)" : "");
+            }
+            break;
+        case ev_command:
+            snprintf(msg, sizeof(msg), "%s: %s", who, r.text);
+            break;
+        case ev_throttled:
+            snprintf(msg, sizeof(msg), "%s is throttled: over the %s rate",
+                     who, r.arg ? "command" : "input");
+            break;
+        case ev_stall:
+            snprintf(msg, sizeof(msg), "%s write stall", who);
+            break;
+        case ev_shed:
+            snprintf(msg, sizeof(msg), "TCP-server sheds connections: %s",
+                     r.text);
+            break;
+        case ev_accept_again:
+            snprintf(msg, sizeof(msg),
+                     "TCP-server accepts again, shed in total: %u",
+                     static_cast<unsigned>(r.arg));
+            break;
+        case ev_mode:
+            snprintf(msg, sizeof(msg), "Mode=%d, bright=%u",
+                     static_cast<int>(static_cast<int32_t>(r.arg)),
+                     static_cast<unsigned>(r.arg2));
+            break;
+        default:
+            snprintf(msg, sizeof(msg), "Unknown event %u",
+                     static_cast<unsigned>(r.event));
+            break;
+    }
+    return msg;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
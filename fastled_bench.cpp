@@ -0,0 +1,347 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Microbenchmarks of the fastled_port primitives over buffers of 75 to
+    1M LEDs: ns per call, LEDs per second, a table or JSON for tracking
+    the regressions between releases
+                                                                     ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "fastled_port.h"
+#include "timer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Kernel over "n" LEDs: reads "src", writes "dst", "round" varies the input:
+typedef void (*KernelFn)(CRGB *dst, const CRGB *src, size_t n,
+                         uint32_t round);
+
+struct BenchCase {
+    const char *name;
+    KernelFn kernel;
+    bool perLed;            // Calls per pass: 1 a LED or 1 a buffer;
+    int callsPerLed;        // For "perLed", r, g and b are 3;
+};
+
+struct BenchResult {
+    const char *name;
+    size_t leds;
+    double nsPerCall;       // Median of the samples;
+    double nsPerCallMin;
+    double ledsPerSec;      // Of the median;
+    uint64_t passes;        // A sample;
+};
+
+// Keeps the stores to "p" the compiler would drop as unread:
+inline void escape(const void *p)
+{
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+const CRGBPalette16 bench_palette{
+    CRGB::Black, CRGB::Red, CRGB::Orange, CRGB::Yellow,
+    CRGB::Green, CRGB::Aqua, CRGB::Blue, CRGB::Purple,
+    CRGB::White, CRGB::Gold, CRGB::Teal, CRGB::Navy,
+    CRGB::Maroon, CRGB::Olive, CRGB::Silver, CRGB::Gray
+};
+
+void k_qadd8(CRGB *dst, const CRGB *src, size_t n, uint32_t round)
+{
+    auto k{ static_cast<uint8_t>(round | 0x40) };
+    for(size_t i = 0; i < n; ++i) {
+        dst[i].r = qadd8(src[i].r, k);
+        dst[i].g = qadd8(src[i].g, k);
+        dst[i].b = qadd8(src[i].b, k);
+    }
+}
+
+void k_scale8(CRGB *dst, const CRGB *src, size_t n, uint32_t round)
+{
+    auto s{ static_cast<uint8_t>(round | 0x80) };
+    for(size_t i = 0; i < n; ++i) {
+        dst[i].r = scale8(src[i].r, s);
+        dst[i].g = scale8(src[i].g, s);
+        dst[i].b = scale8(src[i].b, s);
+    }
+}
+
+void k_nscale8x3(CRGB *dst, const CRGB *src, size_t n, uint32_t round)
+{
+    auto s{ static_cast<uint8_t>(round | 0x80) };
+    for(size_t i = 0; i < n; ++i) {
+        dst[i] = src[i];
+        nscale8x3(dst[i].r, dst[i].g, dst[i].b, s);
+    }
+}
+
+void k_sin8(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        dst[i].r = sin8(static_cast<uint8_t>(i + round));
+    }
+}
+
+void k_sin16(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        dst[i].r = static_cast<uint8_t>(
+                       sin16(static_cast<uint16_t>(i * 97 + round)) >> 8);
+    }
+}
+
+void k_beatsin8(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        dst[i].r = beatsin8(static_cast<uint32_t>(round * 16 + i), 60,
+                            10, 240);
+    }
+}
+
+void k_beatsin16(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        dst[i].r = static_cast<uint8_t>(
+                       beatsin16(static_cast<uint32_t>(round * 16 + i),
+                                 60, 1000, 60000) >> 8);
+    }
+}
+
+void k_beatsin88(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        dst[i].r = static_cast<uint8_t>(
+                       beatsin88(static_cast<uint32_t>(round * 16 + i),
+                                 60 * 256, 1000, 60000) >> 8);
+    }
+}
+
+void k_hsv2rgb_rainbow(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        hsv2rgb_rainbow(CHSV(static_cast<uint8_t>(i + round), 240, 255),
+                        dst[i]);
+    }
+}
+
+void k_fill_rainbow(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    fill_rainbow(dst, static_cast<int>(n), static_cast<uint8_t>(round), 7);
+}
+
+void k_fill_solid(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    fill_solid(dst, static_cast<int>(n),
+               CRGB(static_cast<uint8_t>(round), 0x40, 0x80));
+}
+
+void k_palette_blend(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        dst[i] = ColorFromPalette(bench_palette,
+                                  static_cast<uint8_t>(i * 3 + round),
+                                  255, LINEARBLEND);
+    }
+}
+
+void k_palette_noblend(CRGB *dst, const CRGB*, size_t n, uint32_t round)
+{
+    for(size_t i = 0; i < n; ++i) {
+        dst[i] = ColorFromPalette(bench_palette,
+                                  static_cast<uint8_t>(i * 3 + round),
+                                  200, NOBLEND);
+    }
+}
+
+const BenchCase bench_cases[]{
+    { "qadd8",                      k_qadd8,            true,   3 },
+    { "scale8",                     k_scale8,           true,   3 },
+    { "nscale8x3",                  k_nscale8x3,        true,   1 },
+    { "sin8",                       k_sin8,             true,   1 },
+    { "sin16",                      k_sin16,            true,   1 },
+    { "beatsin8",                   k_beatsin8,         true,   1 },
+    { "beatsin16",                  k_beatsin16,        true,   1 },
+    { "beatsin88",                  k_beatsin88,        true,   1 },
+    { "hsv2rgb_rainbow",            k_hsv2rgb_rainbow,  true,   1 },
+    { "fill_rainbow",               k_fill_rainbow,     false,  0 },
+    { "fill_solid",                 k_fill_solid,       false,  0 },
+    { "ColorFromPalette",           k_palette_blend,    true,   1 },
+    { "ColorFromPalette/noblend",   k_palette_noblend,  true,   1 }
+};
+
+const size_t default_sizes[]{ 75, 300, 1000, 10000, 100000, 1000000 };
+
+// One case at one size: passes enough for "sampleSec" a sample, the
+// median and the best of "samples":
+BenchResult run_case(const BenchCase &bc, size_t n, double sampleSec,
+                     int samples)
+{
+    std::vector<CRGB> src(n);
+    std::vector<CRGB> dst(n);
+    fill_rainbow(src.data(), static_cast<int>(n), 0, 3);
+    uint32_t round{ 0 };
+    // Warm-up, the pages and the caches:
+    bc.kernel(dst.data(), src.data(), n, round++);
+    escape(dst.data());
+    uint64_t passes{ 1 };
+    for(;;) {
+        Timer t;
+        for(uint64_t p = 0; p < passes; ++p) {
+            bc.kernel(dst.data(), src.data(), n, round++);
+            escape(dst.data());
+        }
+        double sec{ t.Elapsed() };
+        if(sec >= sampleSec / 4 || passes >= (uint64_t{ 1 } << 40)) {
+            passes = std::max<uint64_t>(1, static_cast<uint64_t>(
+                         static_cast<double>(passes) * sampleSec /
+                         std::max(sec, 1e-9)));
+            break;
+        }
+        passes *= 4;
+    }
+    std::vector<double> ns;
+    for(int s = 0; s < samples; ++s) {
+        Timer t;
+        for(uint64_t p = 0; p < passes; ++p) {
+            bc.kernel(dst.data(), src.data(), n, round++);
+            escape(dst.data());
+        }
+        ns.push_back(t.Elapsed() * 1e9 / static_cast<double>(passes));
+    }
+    std::sort(ns.begin(), ns.end());
+    double callsPerPass{ bc.perLed ?
+        static_cast<double>(n) * bc.callsPerLed : 1.0 };
+    double median{ ns[ns.size() / 2] };
+    return BenchResult{ bc.name, n, median / callsPerPass,
+                        ns.front() / callsPerPass,
+                        static_cast<double>(n) * 1e9 / median, passes };
+}
+
+void write_json(FILE *f, const std::vector<BenchResult> &results,
+                double sampleSec, int samples)
+{
+    char host[ 64 ]{};
+    gethostname(host, sizeof(host) - 1);
+    fprintf(f, "{\n  \"bench\": \"fastled_port\",\n  \"version\": 1,\n"
+               "  \"time\": %lld,\n  \"host\": \"%s\",\n"
+               "  \"compiler\": \"%s\",\n  \"sample_sec\": %g,\n"
+               "  \"samples\": %d,\n  \"results\": [\n",
+            static_cast<long long>(time(nullptr)), host, __VERSION__,
+            sampleSec, samples);
+    for(size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r{ results[i] };
+        fprintf(f, "    {\"name\": \"%s\", \"leds\": %zu, "
+                   "\"ns_per_op\": %.4f, \"ns_per_op_min\": %.4f, "
+                   "\"leds_per_sec\": %.0f, \"passes\": %llu}%s\n",
+                r.name, r.leds, r.nsPerCall, r.nsPerCallMin, r.ledsPerSec,
+                static_cast<unsigned long long>(r.passes),
+                i + 1 < results.size() ? "," : "");
+    }
+    fputs("  ]\n}\n", f);
+}
+
+void print_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [--quick] [--filter=name] "
+                    "[--sizes=n,n,...] [--json[=file]]\n"
+                    "  --quick       short samples, a smoke run\n"
+                    "  --filter=name the cases whose name contains it\n"
+                    "  --json        JSON on stdout instead of the table\n"
+                    "  --json=file   the table and JSON into the file\n",
+            prog);
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    double sampleSec{ 0.1 };
+    int samples{ 5 };
+    std::string filter{};
+    std::vector<size_t> sizes(std::begin(default_sizes),
+                              std::end(default_sizes));
+    bool jsonOut{ false };
+    std::string jsonFile{};
+    for(int i = 1; i < argc; ++i) {
+        std::string_view arg{ argv[i] };
+        if(arg == "--quick") {
+            sampleSec = 0.01;
+            samples = 3;
+        } else if(arg.starts_with("--filter=")) {
+            filter = arg.substr(9);
+        } else if(arg.starts_with("--sizes=")) {
+            sizes.clear();
+            for(const char *p = argv[i] + 8; *p; ) {
+                char *end{ nullptr };
+                unsigned long long v{ strtoull(p, &end, 10) };
+                if(end == p || v == 0 || v > (1ULL << 28)) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                sizes.push_back(static_cast<size_t>(v));
+                p = (*end == ',') ? end + 1 : end;
+            }
+        } else if(arg == "--json") {
+            jsonOut = true;
+        } else if(arg.starts_with("--json=")) {
+            jsonFile = arg.substr(7);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(sizes.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    if(!jsonOut) {
+        printf("%-26s %9s %12s %14s\n", "case", "LEDs", "ns/op", "LEDs/s");
+    }
+    for(const BenchCase &bc : bench_cases) {
+        if(!filter.empty() &&
+           std::string_view(bc.name).find(filter) == std::string_view::npos) {
+            continue;
+        }
+        for(size_t n : sizes) {
+            results.push_back(run_case(bc, n, sampleSec, samples));
+            if(jsonOut) { continue; }
+            const BenchResult &r{ results.back() };
+            printf("%-26s %9zu %12.3f %14.4g\n", r.name, r.leds,
+                   r.nsPerCall, r.ledsPerSec);
+            fflush(stdout);
+        }
+    }
+    if(jsonOut) { write_json(stdout, results, sampleSec, samples); }
+    if(!jsonFile.empty()) {
+        FILE *f{ fopen(jsonFile.c_str(), "w") };
+        if(!f) {
+            perror(jsonFile.c_str());
+            return 1;
+        }
+        write_json(f, results, sampleSec, samples);
+        fclose(f);
+    }
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
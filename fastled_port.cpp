@@ -13,17 +13,26 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// A 32-bit LCG of our own, rand() differs between the C libraries:
+static uint32_t prandom_state{ 1 };
+
 void prandom_init()
 {
-	std::srand(std::time(nullptr));
+	prandom_seed(static_cast<uint32_t>(std::time(nullptr)));
 }
 
+void prandom_seed(uint32_t seed)
+{
+	prandom_state = seed;
+}
 
 int prandom_range(int upper)
 {	
-	if(upper > RAND_MAX) { upper = RAND_MAX; }
-	double u = upper;
-	return 1 + static_cast<int>((u * rand() / (RAND_MAX + 1.0)));
+	if(upper < 1) { return 1; }
+	prandom_state = prandom_state * 1664525u + 1013904223u;
+	// The high bits, the low ones of an LCG have short periods:
+	uint64_t r{ prandom_state >> 8 };
+	return 1 + static_cast<int>((static_cast<uint64_t>(upper) * r) >> 24);
 }
 
 
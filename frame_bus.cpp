@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Delivery of the presented frames to the network subscribers
+                                                               ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "frame_bus.h"
+
+#include <sys/eventfd.h>
+#include <time.h>
+
+#include <algorithm>
+#include <system_error>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Encoding ///////////////////////////////////////////////////////////////////
+
+namespace {
+
+void put_be32(std::string &out, uint32_t v)
+{
+    out.push_back(static_cast<char>(v >> 24));
+    out.push_back(static_cast<char>(v >> 16));
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+void put_varint(std::string &out, size_t v)
+{
+    while(v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void put_header(std::string &out, uint8_t kind, uint64_t counter)
+{
+    out.push_back(static_cast<char>(le365frame::frame_magic));
+    out.push_back(static_cast<char>(kind));
+    out.push_back(0);
+    out.push_back(0);
+    put_be32(out, static_cast<uint32_t>(counter));
+    put_be32(out, 0); // Payload length, patched in finish_record();
+}
+
+void finish_record(std::string &out, size_t start)
+{
+    uint32_t len{ static_cast<uint32_t>(out.size() - start - 
+                                        le365frame::header_size) };
+    for(size_t i = 0; i < 4; ++i) {
+        out[start + 8 + i] = static_cast<char>(len >> (24 - 8 * i));
+    }
+}
+
+bool same(const CRGB &a, const CRGB &b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+}
+
+void encode_keyframe(std::string &out, const CRGB *leds, size_t count,
+                     uint64_t counter)
+{
+    size_t start{ out.size() };
+    put_header(out, le365frame::frame_key, counter);
+    out.append(reinterpret_cast<const char*>(leds), count * sizeof(CRGB));
+    finish_record(out, start);
+}
+
+uint64_t frame_hash(const CRGB *leds, size_t count)
+{
+    uint64_t h{ 0xcbf29ce484222325ull };
+    auto p{ reinterpret_cast<const uint8_t*>(leds) };
+    for(size_t i = 0; i < count * sizeof(CRGB); ++i) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+void encode_delta(std::string &out, const CRGB *leds, const CRGB *prev, 
+                  size_t count, uint64_t counter)
+{
+    if(!prev) {
+        encode_keyframe(out, leds, count, counter);
+        return;
+    }
+    size_t start{ out.size() };
+    put_header(out, le365frame::frame_delta, counter);
+    size_t i{ 0 };
+    while(i < count) {
+        size_t skip{ 0 };
+        while(i + skip < count && same(leds[i + skip], prev[i + skip])) {
+            ++skip;
+        }
+        if(i + skip == count) { break; } // Unchanged tail is implied;
+        size_t take{ 0 };
+        while(i + skip + take < count && 
+              !same(leds[i + skip + take], prev[i + skip + take])) {
+            ++take;
+        }
+        put_varint(out, skip);
+        put_varint(out, take);
+        out.append(reinterpret_cast<const char*>(leds + i + skip), 
+                   take * sizeof(CRGB));
+        i += skip + take;
+    }
+    // Not worth it? Fall back to a keyframe:
+    if(out.size() - start >= le365frame::header_size + count * sizeof(CRGB)) {
+        out.resize(start);
+        encode_keyframe(out, leds, count, counter);
+        return;
+    }
+    finish_record(out, start);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// FrameBus ///////////////////////////////////////////////////////////////////
+
+static int make_bus_eventfd()
+{
+    int fd{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) };
+    if(fd == -1) [[unlikely]] {
+        throw std::system_error(errno, std::generic_category(), 
+                                "FrameBus in: eventfd()");
+    }
+    return fd;
+}
+
+FrameBus::FrameBus(Selector *sp) 
+    : FdHandler(make_bus_eventfd(), true), sel(sp), mtx(), latest(), 
+      latestInfo(), fresh(false), current(), currentInfo(), rateBase(),
+      fps(0.0), subs()
+{
+    sel->Add(this);
+}
+
+FrameBus::~FrameBus()
+{
+    sel->Remove(this);
+}
+
+void FrameBus::OnFrame(const CRGB *leds, size_t count, const FrameInfo &info)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        latest.assign(leds, leds + count);
+        latestInfo = info;
+        fresh = true;
+    }
+    uint64_t one{ 1 };
+    [[maybe_unused]] ssize_t n{ write(GetFd(), &one, sizeof(one)) };
+}
+
+void FrameBus::Handle(bool r, [[maybe_unused]] bool w)
+{
+    if(!r) [[unlikely]] { return; }
+    uint64_t rings{};
+    [[maybe_unused]] ssize_t n{ read(GetFd(), &rings, sizeof(rings)) };
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(!fresh) { return; }
+        current.swap(latest);
+        currentInfo = latestInfo;
+        fresh = false;
+    }
+    // Counters, not wakeups: frames may coalesce on the way here:
+    uint64_t span{ currentInfo.timestampNs - rateBase.timestampNs };
+    if(rateBase.counter == 0 || span >= 1000000000ull) {
+        if(rateBase.counter != 0 && span > 0) {
+            fps = static_cast<double>(currentInfo.counter - rateBase.counter) *
+                  1e9 / static_cast<double>(span);
+        }
+        rateBase = currentInfo;
+    }
+    for(auto s : subs) { s->OnBusFrame(current.data(), current.size(), 
+                                       currentInfo); }
+}
+
+double FrameBus::Fps() const
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now{ static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + 
+                  static_cast<uint64_t>(ts.tv_nsec) };
+    // No frame for a second, the window above would never close:
+    if(currentInfo.counter == 0 || 
+       now - currentInfo.timestampNs >= 1000000000ull) { return 0.0; }
+    return fps;
+}
+
+void FrameBus::Subscribe(FrameSubscriber *s)
+{
+    if(s && std::find(subs.begin(), subs.end(), s) == subs.end()) {
+        subs.push_back(s);
+    }
+}
+
+void FrameBus::Unsubscribe(FrameSubscriber *s)
+{
+    std::erase(subs, s);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Per-stage profiler of the render loop
+                                         ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "frame_profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: LatencyHistogram ////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t LatencyHistogram::BucketTop(size_t i)
+{
+    if(i < (1u << sub_bits)) { return i; }
+    int e{ static_cast<int>(i >> sub_bits) + sub_bits - 1 };
+    uint64_t sub{ i & ((1u << sub_bits) - 1) };
+    uint64_t low{ ((uint64_t{ 1 } << sub_bits) | sub) << (e - sub_bits) };
+    return low + (uint64_t{ 1 } << (e - sub_bits)) - 1;
+}
+
+void LatencyHistogram::Reset()
+{
+    for(auto &b : buckets) { b.store(0, std::memory_order_relaxed); }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Mean() const
+{
+    uint64_t n{ Count() };
+    return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) /
+               static_cast<double>(n) : 0.0;
+}
+
+uint64_t LatencyHistogram::Quantile(double q) const
+{
+    // The buckets are read while written, the total is theirs, not "count":
+    uint64_t total{ 0 };
+    for(const auto &b : buckets) { total += b.load(std::memory_order_relaxed); }
+    if(total == 0) { return 0; }
+    auto rank{ static_cast<uint64_t>(q * static_cast<double>(total - 1)) };
+    uint64_t seen{ 0 };
+    for(size_t i = 0; i < num_buckets; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if(seen > rank) { return std::min(BucketTop(i), Max()); }
+    }
+    return Max();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: FrameProfiler ///////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+FrameProfiler::FrameProfiler()
+    : stages(), patterns(), commands(), resetAsked(false), 
+      sinceNs(Timer::NowNs()),
+      tracer(), perf(), perfStages(), perfPatterns(), perfAsked(-1),
+      perfOn(false), perfError(0), perfHas(0)
+{}
+
+void FrameProfiler::DoReset()
+{
+    for(auto &h : stages) { h.Reset(); }
+    for(auto &h : patterns) { h.Reset(); }
+    for(auto &h : commands) { h.Reset(); }
+    for(auto &p : perfStages) { p.Reset(); }
+    for(auto &p : perfPatterns) { p.Reset(); }
+    sinceNs.store(Timer::NowNs(), std::memory_order_relaxed);
+    resetAsked.store(false, std::memory_order_relaxed);
+}
+
+void FrameProfiler::ToggleTrace()
+{
+    if(!tracer.Active()) {
+        tracer.Start();
+    } else {
+        tracer.Stop();
+    }
+}
+
+void FrameProfiler::DoPerf()
+{
+    bool on{ perfAsked.exchange(-1, std::memory_order_relaxed) == 1 };
+    if(!on) {
+        perf.Close();
+        perfOn.store(false, std::memory_order_relaxed);
+        perfError.store(0, std::memory_order_relaxed);
+        return;
+    }
+    if(perfOn.load(std::memory_order_relaxed)) { return; }
+    // On this, the writer's thread:
+    int err{ perf.Open() };
+    perfError.store(err, std::memory_order_relaxed);
+    if(err) { return; }
+    for(auto &p : perfStages) { p.Reset(); }
+    for(auto &p : perfPatterns) { p.Reset(); }
+    unsigned has{ 0 };
+    for(size_t i = 0; i < perf_counters; ++i) {
+        if(perf.Has(static_cast<perf_counter>(i))) { has |= 1u << i; }
+    }
+    perfHas.store(has, std::memory_order_relaxed);
+    perfOn.store(true, std::memory_order_relaxed);
+}
+
+void FrameProfiler::ReportPerf(std::string &out, const char *prefix) const
+{
+    char line[ 128 ];
+    int err{ perfError.load(std::memory_order_relaxed) };
+    if(err) {
+        snprintf(line, sizeof(line), "%sperf counters are off: %s%s\n",
+                 prefix, strerror(err),
+                 err == EACCES || err == EPERM ?
+                     " (kernel.perf_event_paranoid)" :
+                 err == ENOENT || err == EOPNOTSUPP ?
+                     " (no such counters, a VM?)" : "");
+        out += line;
+        return;
+    }
+    if(!perfOn.load(std::memory_order_relaxed)) { return; }
+    snprintf(line, sizeof(line), "%s%-10s %9s %9s %5s %9s %9s\n", prefix,
+             "perf, /call", perf_counter_names[perf_cycles],
+             perf_counter_names[perf_instructions], "IPC",
+             perf_counter_names[perf_branch_misses],
+             perf_counter_names[perf_l1d_misses]);
+    out += line;
+    unsigned has{ perfHas.load(std::memory_order_relaxed) };
+    auto row{ [has, &out, &line, prefix](const char *name,
+                                         const PerfSums &p) {
+        double n{ static_cast<double>(p.Calls()) };
+        char v[ perf_counters ][ 16 ];
+        for(size_t i = 0; i < perf_counters; ++i) {
+            if(has & (1u << i)) {
+                auto c{ static_cast<perf_counter>(i) };
+                snprintf(v[i], sizeof(v[i]), "%.0f",
+                         static_cast<double>(p.Sum(c)) / n);
+            } else {
+                snprintf(v[i], sizeof(v[i]), "-");
+            }
+        }
+        double cycles{ static_cast<double>(p.Sum(perf_cycles)) };
+        double ipc{ cycles > 0.0 ?
+                    static_cast<double>(p.Sum(perf_instructions)) / cycles :
+                    0.0 };
+        snprintf(line, sizeof(line), "%s%-10s %9s %9s %5.2f %9s %9s\n",
+                 prefix, name, v[perf_cycles], v[perf_instructions], ipc,
+                 v[perf_branch_misses], v[perf_l1d_misses]);
+        out += line;
+    } };
+    for(prof_stage s : { prof_select, prof_pattern, prof_show }) {
+        if(perfStages[s].Calls() == 0) { continue; }
+        row(prof_stage_names[s], perfStages[s]);
+    }
+    for(size_t i = 0; i < num_patterns; ++i) {
+        if(perfPatterns[i].Calls() == 0) { continue; }
+        char name[ 16 ];
+        snprintf(name, sizeof(name), "pattern %zu", i);
+        row(name, perfPatterns[i]);
+    }
+}
+
+void FrameProfiler::Report(std::string &out, const char *prefix) const
+{
+    char line[ 128 ];
+    double sec{ static_cast<double>(Timer::NowNs() -
+                    sinceNs.load(std::memory_order_relaxed)) / 1e9 };
+    uint64_t frames{ stages[prof_show].Count() };
+    snprintf(line, sizeof(line), "%sfps=%.1f frames=%llu over %.1f s\n",
+             prefix, sec > 0.0 ? static_cast<double>(frames) / sec : 0.0,
+             static_cast<unsigned long long>(frames), sec);
+    out += line;
+    snprintf(line, sizeof(line), "%s%-10s %9s %9s %9s %9s %9s\n", prefix,
+             "stage, us", "count", "p50", "p99", "max", "mean");
+    out += line;
+    auto row{ [&out, &line, prefix](const char *name,
+                                    const LatencyHistogram &h) {
+        snprintf(line, sizeof(line),
+                 "%s%-10s %9llu %9.1f %9.1f %9.1f %9.1f\n", prefix, name,
+                 static_cast<unsigned long long>(h.Count()),
+                 static_cast<double>(h.Quantile(0.5)) / 1e3,
+                 static_cast<double>(h.Quantile(0.99)) / 1e3,
+                 static_cast<double>(h.Max()) / 1e3, h.Mean() / 1e3);
+        out += line;
+    } };
+    for(size_t i = 0; i < prof_stages; ++i) {
+        row(prof_stage_names[i], stages[i]);
+    }
+    // Per-pattern cost, the patterns run since the reset only:
+    for(size_t i = 0; i < num_patterns; ++i) {
+        if(patterns[i].Count() == 0) { continue; }
+        char name[ 16 ];
+        snprintf(name, sizeof(name), "pattern %zu", i);
+        row(name, patterns[i]);
+    }
+    // Command to the next presented frame, the sources seen only:
+    for(size_t i = 0; i < pult_sources; ++i) {
+        if(commands[i].Count() == 0) { continue; }
+        row(pult_source_names[i], commands[i]);
+    }
+    ReportPerf(out, prefix);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Tracing of the render loop, Chrome trace JSON
+                                                 ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "frame_tracer.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: FrameTracer /////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+std::atomic<bool> FrameTracer::toggleAsked{ false };
+
+static_assert(std::atomic<bool>::is_always_lock_free,
+              "The toggle is set from a signal handler");
+
+FrameTracer::Ring* FrameTracer::Local()
+{
+    // A thread registers once per tracer:
+    thread_local FrameTracer *owner{ nullptr };
+    thread_local Ring *ring{ nullptr };
+    if(owner == this) [[likely]] { return ring; }
+    auto r{ std::make_unique<Ring>() };
+    r->tid = static_cast<long>(gettid());
+    char name[ 16 ]{};
+    if(pthread_getname_np(pthread_self(), name, sizeof(name)) == 0) {
+        r->thread = name;
+    }
+    std::lock_guard<std::mutex> lock(ringsLock);
+    rings.push_back(std::move(r));
+    owner = this;
+    ring = rings.back().get();
+    return ring;
+}
+
+void FrameTracer::Start()
+{
+    sinceNs.store(Timer::NowNs(), std::memory_order_relaxed);
+    active.store(true, std::memory_order_release);
+}
+
+long FrameTracer::Stop()
+{
+    active.store(false);
+    uint64_t since{ sinceNs.load(std::memory_order_relaxed) };
+    std::lock_guard<std::mutex> lock(ringsLock);
+    // A record is a few stores, no new one starts from now on:
+    for(const auto &r : rings) {
+        while(r->writing.load(std::memory_order_acquire)) { sched_yield(); }
+    }
+    FILE *f{ fopen(path.c_str(), "w") };
+    if(!f) { return -1; }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    long n{ 0 };
+    const char *sep{ "" };
+    for(const auto &r : rings) {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+                sep, r->tid, r->thread.c_str());
+        sep = ",\n";
+        uint64_t head{ r->head.load(std::memory_order_relaxed) };
+        uint64_t first{ head > le365trace::ring_size ?
+                        head - le365trace::ring_size : 0 };
+        for(uint64_t i = first; i < head; ++i) {
+            const TraceRecord &t{ r->recs[i & (le365trace::ring_size - 1)] };
+            if(!t.name || t.startNs < since) { continue; }
+            // Microseconds since the start of the window:
+            double ts{ static_cast<double>(t.startNs - since) / 1e3 };
+            if(t.durNs == le365trace::instant) {
+                fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+                           "\"ts\":%.3f,\"pid\":1,\"tid\":%ld",
+                        sep, t.name, ts, r->tid);
+            } else {
+                fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+                           "\"dur\":%.3f,\"pid\":1,\"tid\":%ld", sep, t.name,
+                        ts, static_cast<double>(t.durNs) / 1e3, r->tid);
+            }
+            if(t.arg != le365trace::no_arg) {
+                fprintf(f, ",\"args\":{\"v\":%" PRId64 "}", t.arg);
+            }
+            fputc('}', f);
+            ++n;
+        }
+    }
+    fputs("\n]}\n", f);
+    if(fclose(f) != 0) { return -1; }
+    return n;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,329 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Golden-frame regression check of the built-in modes: each mode runs
+    headless for N frames on a virtual clock with a fixed seed of
+    prandom_range(), every presented frame is hashed (XXH64) and compared
+    with the hashes checked in to golden_frames.bin. The first frame that
+    differs is dumped, LED by LED, and the exit code is 1.
+
+    "make golden" builds le365_golden, "make golden_check" runs it;
+    le365_golden --update writes the file anew after a deliberate change
+    of a pattern. The file is for the default strip of 75 LEDs.
+                                                        ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "led_core.h"
+#include "timer.h"
+#include "xxh64.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+typedef std::unique_ptr<Pattern> (*MakeFn)(LEDCore *core, enum_mode m);
+
+template <typename P>
+std::unique_ptr<Pattern> make_mode(LEDCore *core, enum_mode m)
+{
+    return std::make_unique<P>(core, m);
+}
+
+struct ModeCase {
+    const char *name;
+    enum_mode mode;
+    MakeFn make;
+};
+
+// Appending keeps the file valid, a mode is found by its name:
+const ModeCase mode_cases[]{
+    { "rainbow",  mode_1, make_mode<ModeRainbow>        },
+    { "meteor",   mode_2, make_mode<ModeRainbowMeteor>  },
+    { "glitter",  mode_3, make_mode<ModeRainbowGlitter> },
+    { "stars",    mode_4, make_mode<ModeStars>          },
+    { "dots",     mode_5, make_mode<ModeRunningDots>    },
+    { "pacifica", mode_6, make_mode<ModePacifica>       },
+    { "rgb",      mode_7, make_mode<ModeRGB>            },
+    { "cmyk",     mode_8, make_mode<ModeCMYK>           },
+    { "white",    mode_9, make_mode<ModeWhite>          }
+};
+
+constexpr char golden_magic[ 8 ]{ 'L', 'E', '3', '6', '5', 'G', 'L', 'D' };
+constexpr uint32_t golden_version{ 1 };
+constexpr uint32_t golden_seed{ 365 };
+constexpr size_t name_size{ 16 };
+
+// The file: the header, then per mode its name and "frames" hashes:
+struct GoldenHeader {
+    char magic[ 8 ];
+    uint32_t version;
+    uint32_t leds;
+    uint32_t frames;
+    uint32_t modes;
+    uint32_t seed;
+    uint32_t reserved;
+};
+
+struct GoldenMode {
+    std::string name;
+    std::vector<uint64_t> hashes;
+};
+
+// Hashes the presented frames; keeps the first one that is not as
+// expected, while the expected hashes last:
+class HashSink : public FrameSink {
+private:
+    const std::vector<uint64_t> *expected;
+    std::vector<uint64_t> hashes;
+    std::vector<CRGB> firstBad;
+    size_t firstBadIdx;
+public:
+    explicit HashSink(const std::vector<uint64_t> *e)
+        : expected(e), hashes(), firstBad(), firstBadIdx(0) {}
+    void OnFrame(const CRGB *leds, size_t count, const FrameInfo&) override
+    {
+        uint64_t h{ xxh64(leds, count * sizeof(CRGB)) };
+        size_t i{ hashes.size() };
+        hashes.push_back(h);
+        if(expected && i < expected->size() && (*expected)[i] != h &&
+           firstBad.empty()) {
+            firstBad.assign(leds, leds + count);
+            firstBadIdx = i;
+        }
+    }
+    size_t Frames() const { return hashes.size(); }
+    const std::vector<uint64_t>& Hashes() const { return hashes; }
+    bool Differs() const { return !firstBad.empty(); }
+    size_t FirstBadIdx() const { return firstBadIdx; }
+    const std::vector<CRGB>& FirstBad() const { return firstBad; }
+    // No copying and assignment:
+    HashSink(const HashSink&) = delete;
+    HashSink& operator=(const HashSink&) = delete;
+};
+
+// The mode from a fresh core and the fixed seed; the virtual clock
+// moves to the end of each wait, 1 ms at least, as in pattern_bench:
+void run_mode(const ModeCase &mc, size_t frames, HashSink &sink)
+{
+    auto core{ std::make_unique<LEDCore>() };
+    prandom_seed(golden_seed);      // After the constructor, it seeds too;
+    auto pattern{ mc.make(core.get(), mc.mode) };
+    core->SetMode(mc.mode);
+    core->AddSink(&sink);
+    double clock{ 0.0 };
+    core->SetVirtualClock(clock);
+    // A pattern that stops showing must not hang the check:
+    for(size_t step = 0; sink.Frames() < frames && step < frames * 64;
+        ++step) {
+        pattern->Step();
+        clock += std::max(core->LongWaitLeft(), 0.001);
+        core->SetVirtualClock(clock);
+    }
+    core->RemoveSink(&sink);
+}
+
+bool read_golden(const char *path, GoldenHeader &hdr,
+                 std::vector<GoldenMode> &modes)
+{
+    FILE *f{ fopen(path, "rb") };
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    bool ok{ fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+             memcmp(hdr.magic, golden_magic, sizeof(golden_magic)) == 0 &&
+             hdr.version == golden_version };
+    for(uint32_t m = 0; ok && m < hdr.modes; ++m) {
+        char name[ name_size ]{};
+        GoldenMode gm{ std::string(), std::vector<uint64_t>(hdr.frames) };
+        ok = fread(name, sizeof(name), 1, f) == 1 &&
+             fread(gm.hashes.data(), sizeof(uint64_t), hdr.frames, f) ==
+                 hdr.frames;
+        gm.name.assign(name, strnlen(name, sizeof(name)));
+        modes.push_back(std::move(gm));
+    }
+    fclose(f);
+    if(!ok) { fprintf(stderr, "%s: not a golden-frame file\n", path); }
+    return ok;
+}
+
+bool write_golden(const char *path, uint32_t frames,
+                  const std::vector<GoldenMode> &modes)
+{
+    GoldenHeader hdr{};
+    memcpy(hdr.magic, golden_magic, sizeof(golden_magic));
+    hdr.version = golden_version;
+    hdr.leds = static_cast<uint32_t>(le365const::num_leds);
+    hdr.frames = frames;
+    hdr.modes = static_cast<uint32_t>(modes.size());
+    hdr.seed = golden_seed;
+    FILE *f{ fopen(path, "wb") };
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    bool ok{ fwrite(&hdr, sizeof(hdr), 1, f) == 1 };
+    for(const GoldenMode &gm : modes) {
+        char name[ name_size ]{};
+        strncpy(name, gm.name.c_str(), sizeof(name) - 1);
+        ok = ok && fwrite(name, sizeof(name), 1, f) == 1 &&
+             fwrite(gm.hashes.data(), sizeof(uint64_t), frames, f) == frames;
+    }
+    if(fclose(f) != 0) { ok = false; }
+    if(!ok) { perror(path); }
+    return ok;
+}
+
+void dump_frame(FILE *f, const ModeCase &mc, const HashSink &sink,
+                uint64_t expected)
+{
+    size_t idx{ sink.FirstBadIdx() };
+    fprintf(f, "# mode %s, frame %zu: expected %016llx, got %016llx\n",
+            mc.name, idx, static_cast<unsigned long long>(expected),
+            static_cast<unsigned long long>(sink.Hashes()[idx]));
+    fputs("# led rrggbb\n", f);
+    const std::vector<CRGB> &leds{ sink.FirstBad() };
+    for(size_t i = 0; i < leds.size(); ++i) {
+        fprintf(f, "%zu %02x%02x%02x\n", i, leds[i].r, leds[i].g, leds[i].b);
+    }
+}
+
+void print_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [--frames=N] [--filter=mode] [--update] "
+                    "[--golden=file] [--dump=file]\n"
+                    "  --frames=N    frames per mode (default: 10000)\n"
+                    "  --filter=mode the modes whose name contains it\n"
+                    "  --update      write the golden file anew, all the "
+                    "modes\n"
+                    "  --golden=file default: golden_frames.bin\n"
+                    "  --dump=file   the first differing frame into the "
+                    "file, not stdout\n", prog);
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    size_t frames{ 10000 };
+    std::string filter{};
+    bool update{ false };
+    std::string golden{ "golden_frames.bin" };
+    std::string dumpFile{};
+    for(int i = 1; i < argc; ++i) {
+        std::string_view arg{ argv[i] };
+        if(arg.starts_with("--frames=")) {
+            long n{ std::atol(argv[i] + 9) };
+            if(n < 1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            frames = static_cast<size_t>(n);
+        } else if(arg.starts_with("--filter=")) {
+            filter = arg.substr(9);
+        } else if(arg == "--update") {
+            update = true;
+        } else if(arg.starts_with("--golden=")) {
+            golden = arg.substr(9);
+        } else if(arg.starts_with("--dump=")) {
+            dumpFile = arg.substr(7);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    GoldenHeader hdr{};
+    std::vector<GoldenMode> expected;
+    if(!update) {
+        if(!read_golden(golden.c_str(), hdr, expected)) { return 1; }
+        if(hdr.leds != static_cast<uint32_t>(le365const::num_leds) ||
+           hdr.seed != golden_seed) {
+            fprintf(stderr, "%s: %u LEDs and seed %u, this build has %d "
+                            "and %u\n", golden.c_str(), hdr.leds, hdr.seed,
+                    le365const::num_leds, golden_seed);
+            return 1;
+        }
+        frames = std::min(frames, static_cast<size_t>(hdr.frames));
+    }
+
+    std::vector<GoldenMode> actual;
+    int failed{ 0 };
+    FILE *dump{ nullptr };         // The first differing frame per mode;
+    Timer t;
+    for(const ModeCase &mc : mode_cases) {
+        if(!update && !filter.empty() &&
+           std::string_view(mc.name).find(filter) == std::string_view::npos) {
+            continue;
+        }
+        const GoldenMode *gm{ nullptr };
+        for(const GoldenMode &e : expected) {
+            if(e.name == mc.name) { gm = &e; }
+        }
+        if(!update && !gm) {
+            printf("%-10s MISSING from %s\n", mc.name, golden.c_str());
+            ++failed;
+            continue;
+        }
+        HashSink sink(gm ? &gm->hashes : nullptr);
+        Timer tm;
+        run_mode(mc, frames, sink);
+        actual.push_back(GoldenMode{ mc.name, sink.Hashes() });
+        if(sink.Frames() < frames) {
+            printf("%-10s STALLED after %zu frames\n", mc.name,
+                   sink.Frames());
+            ++failed;
+        } else if(update) {
+            printf("%-10s %zu frames, %.3f s\n", mc.name, frames,
+                   tm.Elapsed());
+        } else if(sink.Differs()) {
+            printf("%-10s FAIL at frame %zu\n", mc.name, sink.FirstBadIdx());
+            ++failed;
+            if(!dump) {
+                dump = dumpFile.empty() ? stdout :
+                                          fopen(dumpFile.c_str(), "w");
+                if(!dump) {
+                    perror(dumpFile.c_str());
+                    return 1;
+                }
+            }
+            dump_frame(dump, mc, sink, gm->hashes[sink.FirstBadIdx()]);
+        } else {
+            printf("%-10s ok, %zu frames, %.3f s\n", mc.name, frames,
+                   tm.Elapsed());
+        }
+        fflush(stdout);
+    }
+    if(update) {
+        if(failed ||
+           !write_golden(golden.c_str(), static_cast<uint32_t>(frames),
+                         actual)) {
+            return 1;
+        }
+        printf("%s: %zu modes, %zu frames each\n", golden.c_str(),
+               actual.size(), frames);
+        return 0;
+    }
+    if(dump && dump != stdout) { fclose(dump); }
+    printf("%s, %.3f s\n", failed ? "FAILED" : "PASSED", t.Elapsed());
+    return failed ? 1 : 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
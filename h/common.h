@@ -17,7 +17,54 @@ namespace le365const {
     inline constexpr int select_delay_usec{ 50000 };
     
     inline constexpr int tcp_line_max_length{ 1023 };
-    inline constexpr int tcp_qlen_for_listen{ 16 };
+    inline constexpr int tcp_qlen_for_listen{ 1024 };     // Reconnect storms;
+    inline constexpr int subscribe_default_fps{ 30 };
+    inline constexpr int subscribe_key_interval{ 50 };    // Frames;
+    inline constexpr size_t pult_queue_size{ 1024 };      // Power of 2;
+    inline constexpr size_t pult_commands_per_frame{ 8 }; // Rest wait a frame;
+    inline constexpr size_t pult_stamps_per_frame{ 32 };  // Latency, the rest
+    inline constexpr size_t pult_awaiting_replies{ 64 };  // go unmeasured;
+    inline constexpr size_t shown_history{ 8 };           // Frames, power of 2;
+    inline constexpr int pult_deferred_usec{ 16667 };
+    inline constexpr int tcp_max_shards{ 64 };            // Listener threads;
+    inline constexpr size_t tcp_session_pool{ 256 };      // Preallocated;
+    inline constexpr int timer_tick_msec{ 10 };
+    inline constexpr double tcp_idle_timeout_sec{ 600.0 };  // 0 - never;
+    inline constexpr double tcp_keepalive_sec{ 0.0 };       // 0 - off;
+    inline constexpr double tcp_write_stall_sec{ 30.0 };
+    inline constexpr double tcp_cmd_rate{ 50.0 };           // Per session,
+    inline constexpr double tcp_cmd_burst{ 100.0 };         // commands/s;
+    inline constexpr double tcp_byte_rate{ 65536.0 };       // Input, bytes/s;
+    inline constexpr double tcp_byte_burst{ 65536.0 };
+    inline constexpr std::string_view tcp_local_default_path{ 
+        "/tmp/le365.sock" };                                // Unix socket;
+    
+    /// Pixel-stream server ////////////////////////////////////////////////////
+    inline constexpr int pixel_port_shift{ 1 };       // Default: TCP port + 1
+    inline constexpr int pixel_header_size{ 8 };
+    inline constexpr int pixel_reads_per_wakeup{ 64 };
+    inline constexpr int pixel_discard_size{ 4096 };
+    inline constexpr double live_timeout_sec{ 2.0 };
+    
+    /// UDP frame ingestion ////////////////////////////////////////////////////
+    inline constexpr int udp_e131_port{ 5568 };
+    inline constexpr int udp_artnet_port{ 6454 };
+    inline constexpr int udp_ddp_port{ 4048 };
+    inline constexpr int udp_e131_first_universe{ 1 };
+    inline constexpr int udp_artnet_first_universe{ 0 };
+    inline constexpr int udp_leds_per_universe{ 170 };  // 510 of 512 slots
+    inline constexpr int udp_batch_size{ 64 };          // For recvmmsg()
+    inline constexpr int udp_batches_per_wakeup{ 16 };
+    inline constexpr int udp_datagram_max{ 1536 };
+    inline constexpr double udp_artsync_timeout_sec{ 4.0 };
+    // A frame still waiting for its sync or push is shown after it:
+    inline constexpr double udp_present_timeout_sec{ 0.25 };
+    
+    /// WebSocket viewers //////////////////////////////////////////////////////
+    inline constexpr int ws_port_shift{ 2 };          // Default: TCP port + 2
+    inline constexpr int ws_request_max{ 8192 };      // Headers, client frames
+    inline constexpr int ws_max_fps{ 30 };
+    inline constexpr int ws_key_interval{ 50 };       // Broadcasts;
 
     /// PULT ////////////////////////////////////////////// ! DON'T TOUCH ! ////
     inline constexpr int num_dig_buttons{ 9 };
@@ -42,7 +89,10 @@ namespace le365const {
     inline constexpr int b_down{ 13 };
 
     /// LEDS ///////////////////////////////////////////////////////////////////
-    inline constexpr int num_leds{ 75 };
+#ifndef LE365_NUM_LEDS
+#define LE365_NUM_LEDS 75       // Other sizes for the pattern benchmark;
+#endif
+    inline constexpr int num_leds{ LE365_NUM_LEDS };
     
     inline constexpr int num_columns{ 15 };
     inline constexpr int item_size{ 50 };
@@ -77,6 +127,22 @@ namespace le365const {
     inline constexpr std::string_view client_right      { "right" };
     inline constexpr std::string_view client_left       { "left" };
     inline constexpr std::string_view client_ok         { "ok" };
+    inline constexpr std::string_view client_subscribe  { "subscribe" };
+    inline constexpr std::string_view client_unsubscribe{ "unsubscribe" };
+    inline constexpr std::string_view client_px         { "px" };
+    inline constexpr std::string_view client_range      { "range" };
+    inline constexpr std::string_view client_fill       { "fill" };
+    inline constexpr std::string_view client_grad       { "grad" };
+    inline constexpr std::string_view client_pal        { "pal" };
+    inline constexpr std::string_view client_bri        { "bri" };
+    inline constexpr std::string_view client_begin      { "begin" };
+    inline constexpr std::string_view client_commit     { "commit" };
+    inline constexpr std::string_view client_status     { "status" };
+    inline constexpr std::string_view client_frame      { "frame" };
+    inline constexpr std::string_view client_hash       { "hash" };
+    inline constexpr std::string_view client_stats      { "stats" };
+    inline constexpr std::string_view client_trace      { "trace" };
+    inline constexpr std::string_view client_latency    { "latency" };
     
     /// LOGGING ////////////////////////////////////////////////////////////////
     inline constexpr std::string_view server_log_file{ "le365_tcp.log" };
@@ -94,6 +160,11 @@ enum enum_mode {
   mode_7 = 7, mode_8 = 8, mode_9 = 9
 };
 
+// Where a pult command came from, its latency is kept per source:
+enum pult_source {
+  src_button, src_key, src_network, pult_sources
+};
+
 struct RGBLed {
     int r{};
     int g{};
@@ -0,0 +1,166 @@
+#ifndef EVENT_LOG_AK_H
+#define EVENT_LOG_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Binary event log for the post-mortems: every connect, command and
+    mode change as a fixed 64-byte record in a preallocated, memory-mapped
+    file. A writer takes a slot with one atomic add, fills it in place and
+    publishes it by storing its sequence number last; no syscall, no
+    formatting, no lock. The time is the CPU's time-stamp counter (the
+    system clock costs as much as the rest of the record), the header
+    keeps its rate to the system clock, measured once a second. The file
+    is a ring of "capacity" records, the oldest are overwritten. The pages
+    are the kernel's, the records survive a crash of the process.
+
+    The file is an EventLogHeader followed by the records;
+    le365_event_decode turns it into the text of the server log.
+                                                                 ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace le365evt {
+    inline constexpr uint32_t magic{ 0x4536334C };      // "L36E"
+    inline constexpr uint32_t version{ 1 };
+    inline constexpr size_t default_records{ 65536 };   // Power of 2, 4 MiB;
+    inline constexpr std::string_view default_file{ "le365_events.bin" };
+}
+
+enum event_id : uint16_t {
+    ev_none,
+    ev_connect,           // arg: IPv4 address (network order), arg2: port;
+    ev_connect_local,     // arg: descriptor;
+    ev_disconnect,        // arg: reset, arg2: times throttled;
+    ev_command,           // text: the line, cut;
+    ev_throttled,         // arg: 1 - command rate, 0 - input rate;
+    ev_stall,
+    ev_shed,              // text: the reason;
+    ev_accept_again,      // arg: shed in total;
+    ev_mode,              // arg: the new mode, arg2: brightness;
+    ev_count
+};
+
+// One cache line, writers of different threads never share one:
+struct alignas(64) EventRecord {
+    uint64_t seq{ 0 };           // 1-based, stored last; 0 - never written;
+    uint64_t ticks{ 0 };         // See event_ticks();
+    uint64_t session{ 0 };       // Pool handle of the session, 0 - none;
+    uint16_t event{ ev_none };
+    uint16_t source{ 0 };        // Network shard;
+    uint32_t arg{ 0 };
+    uint32_t arg2{ 0 };
+    char text[ 28 ]{};           // Zero-terminated;
+};
+
+static_assert(sizeof(EventRecord) == 64, "Record is one cache line");
+
+struct EventLogHeader {
+    uint32_t magic{ 0 };
+    uint32_t version{ 0 };
+    uint32_t headerSize{ 0 };    // Offset of record 0 from the file start;
+    uint32_t recordSize{ 0 };
+    uint64_t capacity{ 0 };      // Records, power of 2;
+    // Ticks to the system clock: usec = baseUsec + (ticks - baseTicks) / 
+    // ticksPerUsec, see event_usec():
+    uint64_t baseTicks{ 0 };
+    int64_t baseUsec{ 0 };
+    double ticksPerUsec{ 1.0 };
+    alignas(64) std::atomic<uint64_t> next{ 0 };    // Records ever taken.
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Slot counter must be lock-free to live in the file");
+
+// The time-stamp counter, microseconds of the system clock elsewhere:
+inline uint64_t event_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+               std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+               .count());
+#endif
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: EventLog ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class EventLog {
+private:
+    EventLogHeader *hdr;
+    EventRecord *records;
+    uint64_t mask;
+    size_t mapSize;
+    uint64_t calibrated;         // Ticks of the last Calibrate();
+    static int64_t NowUsec();
+public:
+    // Creates (truncates) the file, "count" is rounded up to a power
+    // of 2; throws std::system_error:
+    EventLog(const char *fileName, size_t count);
+    ~EventLog();
+
+    // Any thread; "text" is cut to fit the record:
+    void Put(event_id ev, uint64_t session, uint16_t source, uint32_t arg,
+             uint32_t arg2 = 0, const char *text = nullptr);
+    uint64_t Written() const
+        { return hdr->next.load(std::memory_order_relaxed); }
+    // Remeasures the rate of the ticks, if a second has passed; from
+    // one thread (the render loop), a crash keeps the last measure:
+    void Calibrate();
+
+    // No copying and assignment:
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+};
+
+inline void EventLog::Put(event_id ev, uint64_t session, uint16_t source,
+                          uint32_t arg, uint32_t arg2, const char *text)
+{
+    uint64_t n{ hdr->next.fetch_add(1, std::memory_order_relaxed) };
+    EventRecord &r{ records[n & mask] };
+    std::atomic_ref<uint64_t> seq{ r.seq };
+    seq.store(0, std::memory_order_relaxed);   // A lapped slot is not valid;
+    r.ticks = event_ticks();
+    r.session = session;
+    r.event = ev;
+    r.source = source;
+    r.arg = arg;
+    r.arg2 = arg2;
+    size_t len{ text ? strnlen(text, sizeof(r.text) - 1) : 0 };
+    std::memcpy(r.text, text ? text : "", len);
+    r.text[len] = 0;
+    seq.store(n + 1, std::memory_order_release);
+}
+
+// System clock of a record, microseconds since the epoch:
+int64_t event_usec(const EventLogHeader &h, const EventRecord &r);
+
+// The text of a record as the server log writes it (after the time), for
+// the decoder; "peer" names the session, empty if its connect is unknown:
+std::string event_message(const EventRecord &r, const std::string &peer);
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -42,8 +42,10 @@ enum TBlendType {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-/// Initializes the pseudo-random number generator.
+/// Initializes the pseudo-random number generator from the time.
 void prandom_init();
+/// Fixed seed, the same sequence on any build (golden-frame tests).
+void prandom_seed(uint32_t seed);
 /// Returns a pseudo-random number from the specified range [1 - upper].
 int prandom_range(int upper);
 
@@ -0,0 +1,96 @@
+#ifndef FRAME_BUS_AK_H
+#define FRAME_BUS_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Delivery of the presented frames to the network subscribers.
+    
+    LEDCore::Show() only stores the newest frame and rings an eventfd,
+    the encoding for every subscriber happens later in the reactor.
+    Frame records on the wire (big-endian):
+      byte 0       frame_magic (never starts a text reply)
+      byte 1       frame_key or frame_delta
+      bytes 2..3   reserved, 0
+      bytes 4..7   frame counter (low 32 bits)
+      bytes 8..11  payload length
+    Keyframe payload: RGB triplets of the whole strip.
+    Delta payload: pairs of LEB128 varints (unchanged LEDs to skip,
+    changed LEDs to take), each pair followed by the changed triplets.
+                                                                      ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace le365frame {
+    inline constexpr uint8_t frame_magic{ 0xFE };
+    inline constexpr uint8_t frame_key{ 'K' };
+    inline constexpr uint8_t frame_delta{ 'D' };
+    inline constexpr size_t header_size{ 12 };
+}
+
+// Appends a record to "out", "prev" may be null (keyframe is forced):
+void encode_keyframe(std::string &out, const CRGB *leds, size_t count,
+                     uint64_t counter);
+void encode_delta(std::string &out, const CRGB *leds, const CRGB *prev, 
+                  size_t count, uint64_t counter);
+// FNV-1a over the RGB bytes: equal colors, equal hash on any build:
+uint64_t frame_hash(const CRGB *leds, size_t count);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: FrameBus ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class FrameBus : public FrameSink, public FdHandler {
+private:
+    Selector *sel;
+    std::mutex mtx;                     // Guards "latest" and "latestInfo";
+    std::vector<CRGB> latest;
+    FrameInfo latestInfo;
+    bool fresh;
+    std::vector<CRGB> current;          // Reactor's copy of the newest frame;
+    FrameInfo currentInfo;
+    FrameInfo rateBase;                 // Start of the FPS window;
+    double fps;
+    std::vector<FrameSubscriber*> subs;
+public:
+    FrameBus(Selector *sp);             // Throws std::system_error;
+    virtual ~FrameBus();
+    
+    // Render side:
+    virtual void OnFrame(const CRGB *leds, size_t count, 
+                         const FrameInfo &info);
+    // Reactor side:
+    virtual void Handle(bool r, bool w);
+    void Subscribe(FrameSubscriber *s);
+    void Unsubscribe(FrameSubscriber *s);
+    size_t Subscribers() const { return subs.size(); }
+    const CRGB* Current() const { return current.data(); }
+    size_t CurrentSize() const { return current.size(); }
+    const FrameInfo& CurrentInfo() const { return currentInfo; }
+    // Presented frames per second, 0 when the strip stands still:
+    double Fps() const;
+    
+    // No copying and assignment:
+    FrameBus(const FrameBus&) = delete;
+    FrameBus& operator=(const FrameBus&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
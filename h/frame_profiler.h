@@ -0,0 +1,316 @@
+#ifndef FRAME_PROFILER_AK_H
+#define FRAME_PROFILER_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Per-stage profiler of the render loop: scoped timers (Timer::NowNs(),
+    no allocation) feed log-linear latency histograms, one per stage of
+    MainLoop and one per pattern's PatternStep(), and the tracer when it
+    is on (see frame_tracer.h). The command-to-photon latency, from the
+    arrival of a pult command to the end of the next LEDCore::Show(), is
+    kept per source of the commands. Optionally ("stats perf on", --perf)
+    the hardware counters of the render thread (see perf_counters.h) are
+    read around Select(), each PatternStep() and Show() too; a read is a
+    system call, a microsecond or so. The render thread is the only
+    writer; the network thread reads the counters for the "stats" command
+    while they are written (single-writer relaxed atomics, a plain load
+    and store on x86) and asks for a reset, done by the writer.
+
+    Built with LE365_PROFILE (make PROFILE=1, the default), the
+    LE365_PROF_* macros compile to nothing without it.
+                                                               ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "frame_tracer.h"
+#include "perf_counters.h"
+#include "timer.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum prof_stage {
+    prof_select,        // Waiting in Selector::Select();
+    prof_garbage,       // PixelServer::GarbCollect();
+    prof_commands,      // The pult commands of the frame, their Show() too;
+    prof_pattern,       // Pattern::PatternStep() of any pattern;
+    prof_show,          // LEDCore::Show() with the frame sinks;
+    prof_fltk,          // Fl::check();
+    prof_busy,          // A loop turn without the wait;
+    prof_stages
+};
+
+inline constexpr const char *prof_stage_names[ prof_stages ]{
+    "select", "garbage", "commands", "pattern", "show", "fltk", "busy"
+};
+
+inline constexpr const char *pult_source_names[ pult_sources ]{
+    "cmd button", "cmd key", "cmd net"
+};
+
+// HDR-style: 16 linear sub-buckets per power of 2, ~6% resolution from
+// 16 ns to minutes; single writer, any readers:
+class LatencyHistogram {
+private:
+    static constexpr int sub_bits{ 4 };
+    static constexpr int max_exp{ 40 };         // 2^40 ns, 18 minutes;
+    static constexpr size_t num_buckets{
+        static_cast<size_t>((max_exp - sub_bits + 2) << sub_bits) };
+    std::array<std::atomic<uint32_t>, num_buckets> buckets;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+    static size_t Bucket(uint64_t ns);
+    static uint64_t BucketTop(size_t i);
+    template <typename T>
+    static void Bump(std::atomic<T> &a, T by)
+        { a.store(a.load(std::memory_order_relaxed) + by,
+                  std::memory_order_relaxed); }
+public:
+    LatencyHistogram() : buckets(), count(0), sum(0), max(0) {}
+    void Add(uint64_t ns);
+    void Reset();
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return max.load(std::memory_order_relaxed); }
+    double Mean() const;
+    // Upper bound of the bucket holding the "q" quantile, ns:
+    uint64_t Quantile(double q) const;
+    // No copying and assignment:
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+};
+
+inline size_t LatencyHistogram::Bucket(uint64_t ns)
+{
+    if(ns < (1u << sub_bits)) { return static_cast<size_t>(ns); }
+    int e{ 63 - __builtin_clzll(ns) };
+    if(e > max_exp) { return num_buckets - 1; }
+    return static_cast<size_t>(((e - sub_bits + 1) << sub_bits) |
+        static_cast<int>((ns >> (e - sub_bits)) & ((1u << sub_bits) - 1)));
+}
+
+inline void LatencyHistogram::Add(uint64_t ns)
+{
+    Bump(buckets[Bucket(ns)], 1u);
+    Bump(count, uint64_t{ 1 });
+    Bump(sum, ns);
+    if(ns > max.load(std::memory_order_relaxed)) {
+        max.store(ns, std::memory_order_relaxed);
+    }
+}
+
+
+// Counter totals of a stage or a pattern, single writer as above:
+class PerfSums {
+private:
+    std::array<std::atomic<uint64_t>, perf_counters> sums;
+    std::atomic<uint64_t> calls;
+public:
+    PerfSums() : sums(), calls(0) {}
+    void Add(const PerfSample &before, const PerfSample &after)
+    {
+        for(size_t i = 0; i < perf_counters; ++i) {
+            sums[i].store(sums[i].load(std::memory_order_relaxed) +
+                          after.v[i] - before.v[i], std::memory_order_relaxed);
+        }
+        calls.store(calls.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    }
+    void Reset()
+    {
+        for(auto &s : sums) { s.store(0, std::memory_order_relaxed); }
+        calls.store(0, std::memory_order_relaxed);
+    }
+    uint64_t Calls() const { return calls.load(std::memory_order_relaxed); }
+    uint64_t Sum(perf_counter c) const
+        { return sums[c].load(std::memory_order_relaxed); }
+    // No copying and assignment:
+    PerfSums(const PerfSums&) = delete;
+    PerfSums& operator=(const PerfSums&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: FrameProfiler ///////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class FrameProfiler {
+private:
+    static constexpr size_t num_patterns{ 10 };     // mode_stop .. mode_9;
+    std::array<LatencyHistogram, prof_stages> stages;
+    std::array<LatencyHistogram, num_patterns> patterns;
+    std::array<LatencyHistogram, pult_sources> commands;   // To the photon;
+    std::atomic<bool> resetAsked;
+    std::atomic<uint64_t> sinceNs;      // Start of the statistics;
+    FrameTracer tracer;
+    // The counters of the writer, opened and closed by it:
+    PerfCounters perf;
+    std::array<PerfSums, prof_stages> perfStages;
+    std::array<PerfSums, num_patterns> perfPatterns;
+    std::atomic<int> perfAsked;         // -1 - nothing, 0 - off, 1 - on;
+    std::atomic<bool> perfOn;
+    std::atomic<int> perfError;         // errno of the last Open();
+    std::atomic<unsigned> perfHas;      // Bit per perf_counter opened;
+    void DoReset();
+    void ToggleTrace();
+    void DoPerf();
+    void ReportPerf(std::string &out, const char *prefix) const;
+public:
+    FrameProfiler();
+    void Add(prof_stage s, uint64_t startNs, uint64_t endNs);
+    void AddPattern(enum_mode m, uint64_t startNs, uint64_t endNs);
+    void AddCommand(pult_source s, uint64_t ns) { commands[s].Add(ns); }
+    FrameTracer& Tracer() { return tracer; }
+    // Writer side, once a loop turn: applies a reset asked for and
+    // the tracing toggled by the signal:
+    void Poll() {
+        if(resetAsked.load(std::memory_order_relaxed)) { DoReset(); }
+        if(FrameTracer::TakeToggle()) [[unlikely]] { ToggleTrace(); }
+        if(perfAsked.load(std::memory_order_relaxed) != -1) [[unlikely]] {
+            DoPerf();
+        }
+    }
+    // Writer side, the scopes: the stages the counters are read around:
+    bool PerfCounting(prof_stage s) const {
+        return (s == prof_select || s == prof_pattern || s == prof_show) &&
+               perfOn.load(std::memory_order_relaxed);
+    }
+    bool PerfRead(PerfSample &s) const { return perf.Read(s); }
+    void AddPerf(prof_stage s, const PerfSample &before);
+    void AddPerfPattern(enum_mode m, const PerfSample &before);
+    // Any thread:
+    void AskReset() { resetAsked.store(true, std::memory_order_relaxed); }
+    void AskPerf(bool on)
+        { perfAsked.store(on ? 1 : 0, std::memory_order_relaxed); }
+    // Lines of "stats", each starts with "prefix" and ends with '\n'; the
+    // counters per call follow the timings while they are on:
+    void Report(std::string &out, const char *prefix) const;
+    // No copying and assignment:
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+};
+
+inline void FrameProfiler::Add(prof_stage s, uint64_t startNs,
+                               uint64_t endNs)
+{
+    stages[s].Add(endNs - startNs);
+    tracer.Record(prof_stage_names[s], startNs, endNs - startNs);
+}
+
+inline void FrameProfiler::AddPattern(enum_mode m, uint64_t startNs,
+                                      uint64_t endNs)
+{
+    stages[prof_pattern].Add(endNs - startNs);
+    tracer.Record(prof_stage_names[prof_pattern], startNs, endNs - startNs,
+                  m);
+    if(m >= mode_stop && static_cast<size_t>(m) < num_patterns) {
+        patterns[static_cast<size_t>(m)].Add(endNs - startNs);
+    }
+}
+
+inline void FrameProfiler::AddPerf(prof_stage s, const PerfSample &before)
+{
+    PerfSample after;
+    if(perf.Read(after)) { perfStages[s].Add(before, after); }
+}
+
+inline void FrameProfiler::AddPerfPattern(enum_mode m,
+                                          const PerfSample &before)
+{
+    PerfSample after;
+    if(!perf.Read(after)) { return; }
+    perfStages[prof_pattern].Add(before, after);
+    if(m >= mode_stop && static_cast<size_t>(m) < num_patterns) {
+        perfPatterns[static_cast<size_t>(m)].Add(before, after);
+    }
+}
+
+// Times its scope into a stage, nothing if the profiler is nullptr; the
+// counters are read inside the clock readings, closest to the work:
+class ProfScope {
+private:
+    FrameProfiler *prof;
+    prof_stage stage;
+    uint64_t start;
+    bool counting;
+    PerfSample before;
+public:
+    ProfScope(FrameProfiler *p, prof_stage s)
+        : prof(p), stage(s), start(p ? Timer::NowNs() : 0),
+          counting(p && p->PerfCounting(s)), before()
+    {
+        // A failed read would leave "before" at 0, the totals so far:
+        if(counting) [[unlikely]] { counting = prof->PerfRead(before); }
+    }
+    ~ProfScope()
+    {
+        if(!prof) { return; }
+        if(counting) [[unlikely]] { prof->AddPerf(stage, before); }
+        prof->Add(stage, start, Timer::NowNs());
+    }
+    // No copying and assignment:
+    ProfScope(const ProfScope&) = delete;
+    ProfScope& operator=(const ProfScope&) = delete;
+};
+
+class ProfPatternScope {
+private:
+    FrameProfiler *prof;
+    enum_mode mode;
+    uint64_t start;
+    bool counting;
+    PerfSample before;
+public:
+    ProfPatternScope(FrameProfiler *p, enum_mode m)
+        : prof(p), mode(m), start(p ? Timer::NowNs() : 0),
+          counting(p && p->PerfCounting(prof_pattern)), before()
+    {
+        if(counting) [[unlikely]] { counting = prof->PerfRead(before); }
+    }
+    ~ProfPatternScope()
+    {
+        if(!prof) { return; }
+        if(counting) [[unlikely]] { prof->AddPerfPattern(mode, before); }
+        prof->AddPattern(mode, start, Timer::NowNs());
+    }
+    // No copying and assignment:
+    ProfPatternScope(const ProfPatternScope&) = delete;
+    ProfPatternScope& operator=(const ProfPatternScope&) = delete;
+};
+
+#define LE365_PROF_CAT2(a, b) a##b
+#define LE365_PROF_CAT(a, b) LE365_PROF_CAT2(a, b)
+
+#ifdef LE365_PROFILE
+#define LE365_PROF_SCOPE(prof, stage) \
+    ProfScope LE365_PROF_CAT(profScope, __LINE__){ (prof), (stage) }
+#define LE365_PROF_PATTERN(prof, mode) \
+    ProfPatternScope LE365_PROF_CAT(profScope, __LINE__){ (prof), (mode) }
+#define LE365_PROF_POLL(prof) do { if(prof) { (prof)->Poll(); } } while(0)
+#define LE365_TRACE_SCOPE(prof, name, arg) \
+    TraceScope LE365_PROF_CAT(traceScope, __LINE__){ \
+        (prof) ? &(prof)->Tracer() : nullptr, (name), (arg) }
+#define LE365_TRACE_INSTANT(prof, name, arg) \
+    do { if(prof) { (prof)->Tracer().Instant((name), (arg)); } } while(0)
+#else
+#define LE365_PROF_SCOPE(prof, stage) do {} while(0)
+#define LE365_PROF_PATTERN(prof, mode) do {} while(0)
+#define LE365_PROF_POLL(prof) do {} while(0)
+#define LE365_TRACE_SCOPE(prof, name, arg) do {} while(0)
+#define LE365_TRACE_INSTANT(prof, name, arg) do {} while(0)
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
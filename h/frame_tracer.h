@@ -0,0 +1,142 @@
+#ifndef FRAME_TRACER_AK_H
+#define FRAME_TRACER_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Optional tracing of the render loop stages, the TCP commands and the
+    mode switches, dumped as Chrome trace JSON (chrome://tracing, Perfetto).
+
+    Every thread records into its own ring (allocated on its first record,
+    the only allocation), a record is a complete event: a static name, the
+    start, the duration and an argument. Off, a record costs one relaxed
+    load. Start() begins a window, Stop() ends it and writes the records
+    of the window still held by the rings; a ring keeps the newest
+    ring_size records of its thread, a few seconds of the render loop.
+    Both run on the render thread (SIGUSR1 and "trace" are routed there),
+    Stop() waits for the records in progress before it reads the rings.
+                                                                      ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "timer.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace le365trace {
+    inline constexpr size_t ring_size{ 65536 };     // Records, power of 2;
+    inline constexpr std::string_view default_file{ "le365_trace.json" };
+    inline constexpr uint64_t instant{ ~uint64_t{ 0 } };    // Duration;
+    inline constexpr int64_t no_arg{ INT64_MIN };
+}
+
+struct TraceRecord {
+    const char *name{ nullptr };        // Static storage;
+    uint64_t startNs{ 0 };              // Timer::NowNs();
+    uint64_t durNs{ 0 };                // le365trace::instant - an instant;
+    int64_t arg{ 0 };                   // le365trace::no_arg - none;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: FrameTracer /////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class FrameTracer {
+private:
+    struct Ring {
+        std::array<TraceRecord, le365trace::ring_size> recs{};
+        std::atomic<uint64_t> head{ 0 };        // Records ever written;
+        std::atomic<bool> writing{ false };     // A record in progress;
+        long tid{ 0 };
+        std::string thread{};
+    };
+    std::atomic<bool> active;
+    std::atomic<uint64_t> sinceNs;              // Start of the window;
+    std::mutex ringsLock;                       // Registration and dumps;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::string path;                           // Set before the threads;
+    static std::atomic<bool> toggleAsked;
+    Ring* Local();
+public:
+    FrameTracer() : active(false), sinceNs(0), ringsLock(), rings(),
+                    path(le365trace::default_file) {}
+    bool Active() const { return active.load(std::memory_order_relaxed); }
+    // The trace goes to default_file in "dir", never to a path of a client:
+    void SetDir(const std::string &dir)
+        { path = dir + '/' + std::string(le365trace::default_file); }
+    const std::string& Path() const { return path; }
+    // Render thread:
+    void Start();
+    // Stops and writes the window to Path(), the number of events written
+    // or -1 (errno tells):
+    long Stop();
+    // Any thread:
+    void Record(const char *name, uint64_t startNs, uint64_t durNs,
+                int64_t arg = le365trace::no_arg);
+    void Instant(const char *name, int64_t arg = le365trace::no_arg)
+        { Record(name, Timer::NowNs(), le365trace::instant, arg); }
+    // From a signal handler: Start() or Stop() on the next TakeToggle()
+    // of the render loop:
+    static void AskToggle() { toggleAsked.store(true); }
+    static bool TakeToggle()
+        { return toggleAsked.load(std::memory_order_relaxed) &&
+                 toggleAsked.exchange(false); }
+    // No copying and assignment:
+    FrameTracer(const FrameTracer&) = delete;
+    FrameTracer& operator=(const FrameTracer&) = delete;
+};
+
+inline void FrameTracer::Record(const char *name, uint64_t startNs,
+                                uint64_t durNs, int64_t arg)
+{
+    if(!Active()) { return; }
+    Ring *r{ Local() };
+    // Either Stop() sees the flag and waits, or this sees the tracing off:
+    r->writing.store(true);
+    if(!active.load()) { 
+        r->writing.store(false, std::memory_order_relaxed);
+        return;
+    }
+    uint64_t h{ r->head.load(std::memory_order_relaxed) };
+    r->recs[h & (le365trace::ring_size - 1)] = { name, startNs, durNs, arg };
+    r->head.store(h + 1, std::memory_order_relaxed);
+    r->writing.store(false, std::memory_order_release);
+}
+
+// Times its scope as one event, if the tracing was on at its start:
+class TraceScope {
+private:
+    FrameTracer *tracer;
+    const char *name;
+    int64_t arg;
+    uint64_t start;
+public:
+    TraceScope(FrameTracer *t, const char *aName, int64_t anArg)
+        : tracer(t && t->Active() ? t : nullptr), name(aName), arg(anArg),
+          start(tracer ? Timer::NowNs() : 0) {}
+    ~TraceScope()
+        { if(tracer) { tracer->Record(name, start, Timer::NowNs() - start,
+                                      arg); } }
+    // No copying and assignment:
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef HEADLESS_SRV_AK_H
+#define HEADLESS_SRV_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    The emulator without its window, for the benchmarks and the load
+    generator: the network shards and the real MainLoop (the patterns,
+    the command budget per frame, the replies after the frame) on a
+    headless LEDCore, in a render thread of its own. No pixel-stream
+    port, no event log, no profiler.
+                                                                 ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "srv_logger.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+#include "pult_queue.h"
+#include "net_shards.h"
+#include "main_loop.h"
+
+#include <thread>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: HeadlessServer //////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class HeadlessServer {
+private:
+    SrvLogger logger;           // Connects go to std::clog, not stdout;
+    LEDCore core;
+    Selector renderSel;
+    PultQueue commands;
+    NetShards network;
+    MainLoop loop;
+    std::thread render;
+public:
+    // TCP "port" on "shards" listeners and the Unix socket "localPath"
+    // unless empty; "limits" - the default rate limits of the clients:
+    HeadlessServer(int port, int shards, const char *localPath, 
+                   bool limits);
+    ~HeadlessServer();
+    // No copying and assignment:
+    HeadlessServer(const HeadlessServer&) = delete;
+    HeadlessServer& operator=(const HeadlessServer&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
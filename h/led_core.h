@@ -13,13 +13,46 @@
 
 #include "common.h"
 #include "fastled_port.h"
+#include "frame_profiler.h"
 #include "oofl.h"
 #include "timer.h"
 
 #include <FL/Fl.H>
 
+#include <algorithm>
 #include <array>
 #include <bitset>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: FrameSink (consumers of the presented frames) ///////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+struct FrameInfo {
+    uint64_t counter;       // Number of the frame since start;
+    uint64_t timestampNs;   // CLOCK_MONOTONIC at presentation;
+    enum_mode mode;
+    int bright;
+};
+
+class FrameSink {
+public:
+    // Called from LEDCore::Show() with the colors as the strip shows them:
+    virtual void OnFrame(const CRGB *leds, size_t count, 
+                         const FrameInfo &info) = 0;
+    virtual ~FrameSink() = default;
+};
+
+class FrameSubscriber {
+public:
+    // Called from the reactor by FrameBus (see frame_bus.h):
+    virtual void OnBusFrame(const CRGB *leds, size_t count, 
+                            const FrameInfo &info) = 0;
+    virtual ~FrameSubscriber() = default;
+};
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -32,20 +65,38 @@ class LEDCore {
 private:
     Timer mainTimer;    
     Timer waitTimer;
+    Timer liveTimer;
     std::array<OOFLBox*, le365const::num_leds> leds;
     std::array<CRGB, le365const::num_leds> fstleds;
+    std::array<CRGB, le365const::num_leds> presented;
+    std::vector<FrameSink*> sinks;
+    FrameProfiler *prof{ nullptr };     // Render thread's, may be nullptr;
+    uint64_t frameCounter{ 0 };
+    // Arrival of the commands since the last Show(), for their latency:
+    std::array<uint64_t, le365const::pult_stamps_per_frame> stampNs{};
+    std::array<pult_source, le365const::pult_stamps_per_frame> stampSrc{};
+    size_t stamps{ 0 };
+    // End of Show() of the last frames, by frame number:
+    std::array<uint64_t, le365const::shown_history> shownNs{};
+    // Set by a benchmark, the patterns run on it instead of the timers:
+    bool virtualClock{ false };
+    double virtualSec{ 0.0 };
+    double virtualWaitStart{ 0.0 };
     enum_mode currentMode{ mode_null };
     enum_mode befStopMode{ mode_null };
     bool isStop{ false };
     bool core_quit_flag{ false };
     bool in_waiting{ false };
     double wait_for{ 0.0 };    
+    bool in_live{ false };
+    bool live_dirty{ false };
     int bright{ le365const::init_bright };
     const int k_min_num_mode{ 1 };
     const int k_max_num_mode{ 9 };
 public:
 	// Initializing the pseudo-random number generator in the constructor:
-    LEDCore() : mainTimer(), waitTimer(), leds(), fstleds() { prandom_init(); }
+    LEDCore() : mainTimer(), waitTimer(), liveTimer(), leds(), fstleds(),
+                presented(), sinks() { prandom_init(); }
 
     // No copying and assignment:
     LEDCore(const LEDCore&) = delete;
@@ -56,7 +107,17 @@ public:
  
     int GetBright() const { return bright; }
     enum_mode GetMode() const { return currentMode; }
-    uint32_t GetMillis() const { return mainTimer.Elapsed() * 1000;  }
+    uint32_t GetMillis() const 
+        { return (virtualClock ? virtualSec : mainTimer.Elapsed()) * 1000; }
+    uint64_t GetFrameCounter() const { return frameCounter; }
+    const CRGB* GetPresented() const { return presented.data(); }
+    // When "frame" was presented, 0 if it is older than the history:
+    uint64_t ShownNs(uint64_t frame) const;
+    
+    void AddSink(FrameSink *s) { if(s) { sinks.push_back(s); } }
+    void RemoveSink(FrameSink *s);
+    void SetProfiler(FrameProfiler *p) { prof = p; }
+    FrameProfiler* Profiler() const { return prof; }
  
     void SetMode(enum_mode m);
     void BrightUp();
@@ -66,33 +127,95 @@ public:
     void NextMode();
     
     void SetBright(int b) { bright = b; }
-    void Show();
+    // A command stamped on arrival, measured to the next Show():
+    void CommandArrived(pult_source s, uint64_t ns);
+    void Show() { Show(fstleds.data()); }
+    void Show(const CRGB *src);
     void Clear();
     void Waits(double sec);
     void Fill(int r, int g, int b);
     
-    void FltkStep() { if(!Fl::check()) { core_quit_flag = true; } }
+    void FltkStep() { 
+        if(!leds.front()) { return; }   // No widgets, headless;
+        LE365_PROF_SCOPE(prof, prof_fltk);
+        if(!Fl::check()) { core_quit_flag = true; } 
+    }
     bool CoreRun() const { return !core_quit_flag; }
     
     void SetLongWait(double sec);
     void ClearLongWait();
     bool NoLongWait();
+    double LongWaitLeft() const 
+        { return std::max(0.0, wait_for - WaitElapsed()); }
+    double WaitElapsed() const 
+        { return virtualClock ? virtualSec - virtualWaitStart : 
+                                waitTimer.Elapsed(); }
+    // Headless benchmarks: the clock of the patterns and their waits, 
+    // seconds, the timers are not read after it:
+    void SetVirtualClock(double sec) { virtualClock = true; virtualSec = sec; }
+    
+    // Live pixel stream, bypasses the active Pattern until it times out:
+    uint8_t* GetLiveBuffer() 
+        { return reinterpret_cast<uint8_t*>(fstleds.data()); }
+    size_t GetLiveBufferSize() const { return sizeof(fstleds); }
+    void BeginLiveFrame();
+    void CommitLiveFrame();
+    void ReleaseLive();
+    // Presents a frame owned by somebody else, copied in as the live frame:
+    void PresentExternal(const CRGB *src);
+    bool LiveStep();
+    bool InLive() const { return in_live; }
 };
 
+static_assert(sizeof(CRGB) == 3, "CRGB must be a packed RGB triplet");
+
+enum enum_pult_cmd {
+	pult_mode, pult_ok, pult_up, pult_down, pult_left, pult_right,
+	pult_bright, pult_frame, pult_commit,
+	pult_trace_start, pult_trace_stop   // Run by MainLoop, not the core;
+};
+
+class PultQueue;
+
+// A pult command from any source (buttons, keyboard, network):
+struct PultCommand {
+	enum_pult_cmd cmd{ pult_ok };
+	enum_mode mode{ mode_null };        // For pult_mode;
+	PultQueue *replyTo{ nullptr };      // Network commands are acknowledged
+	uint64_t origin{ 0 };               // to this session, see tcp_srv.h;
+	int value{ -1 };                    // Brightness, -1 keeps it; events
+	                                    // written by trace stop, or -errno;
+	pult_source source{ src_button };
+	uint64_t stampNs{ 0 };              // Timer::NowNs() on arrival, 0 - none;
+	bool timed{ false };                // Acknowledge once presented,
+	uint64_t latencyNs{ 0 };            // with the latency, 0 - unknown;
+	// For pult_frame and pult_commit, presented as one live frame:
+	std::array<CRGB, le365const::num_leds> frame{};
+};
+
+// The only way the pult changes LEDCore, must run on the render thread.
+// Network commands get here through PultQueue (see pult_queue.h).
 class CorePultInterface {
 private:
-	LEDCore *core;
+	LEDCore *core{ nullptr };
+	pult_source source{ src_button };   // Of the commands below;
+	void Local(enum_pult_cmd cmd, enum_mode m = mode_null)
+		{ Execute(PultCommand{ cmd, m, nullptr, 0, -1, source, 
+		                       Timer::NowNs() }); }
 public:
 	CorePultInterface() = default;
 	
-	void Init(LEDCore *cp) { if(cp) { core = cp; } }
+	void Init(LEDCore *cp, pult_source s = src_button) 
+		{ if(cp) { core = cp; } source = s; }
+	
+	void Execute(const PultCommand &c);
 	
-	void Mode(enum_mode m) 	{	core->SetMode(m);	}
-	void Ok()				{	core->StopMode();	}
-	void Up() 				{	core->BrightUp();	}
-	void Down()				{	core->BrightDown();	}
-	void Left() 			{	core->PrevMode();	}
-	void Right() 			{	core->NextMode();	}
+	void Mode(enum_mode m) 	{	Local(pult_mode, m);	}
+	void Ok()				{	Local(pult_ok);			}
+	void Up() 				{	Local(pult_up);			}
+	void Down()				{	Local(pult_down);		}
+	void Left() 			{	Local(pult_left);		}
+	void Right() 			{	Local(pult_right);		}
 	
 	// No copying and assignment:
     CorePultInterface(const CorePultInterface&) = delete;
@@ -133,7 +256,10 @@ public:
     void Step() {
         if(core->NoLongWait()) { 
         	LoadState();
-        	PatternStep(); 
+        	{
+        	    LE365_PROF_PATTERN(core->Profiler(), mode);
+        	    PatternStep(); 
+        	}
         	core->Show();
         	core->FltkStep();
         	SaveState();
@@ -280,6 +406,9 @@ protected:
 	// Deepen the blues and greens
 	void pacifica_deepen_colors();
 	virtual void PatternStep();
+	// The "color index start" counters of the four layers:
+	uint16_t sCIStart1{ 0 }, sCIStart2{ 0 }, sCIStart3{ 0 }, sCIStart4{ 0 };
+	uint32_t sLastms{ 0 };
 public:
 	ModePacifica(LEDCore *c, enum_mode m) : Pattern(c, m) {}
 	virtual ~ModePacifica() = default;
@@ -45,12 +45,13 @@ public:
 
 class Pult : public OOFLButton {
 protected:
-    LEDCore *core;
+    CorePultInterface cpi;
 public:
     Pult(int x, int y, const char *lb, LEDCore *c)
         : OOFLButton(x, y, le365const::item_size, 
-                           le365const::item_size, lb), core(c) 
+                           le365const::item_size, lb), cpi() 
     {
+        cpi.Init(c);
         box(FL_FLAT_BOX);
         color(FL_GRAY);
         labelcolor(FL_BLACK);
@@ -68,28 +69,28 @@ public:
     ModeButton(int x, int y, const char *lb, LEDCore *c, enum_mode m)
         : Pult(x, y, lb, c), mode(m)
             { labelsize(le365const::font_size_digit_button); }
-    virtual void OnPress() { core->SetMode(mode); }
+    virtual void OnPress() { cpi.Mode(mode); }
 };
 
 class OkButton : public Pult {
 public:
     OkButton(int x, int y, const char *lb, LEDCore *c)
         : Pult(x, y, lb, c) { labelsize(le365const::font_size_control_button); }
-    virtual void OnPress() { core->StopMode();  }
+    virtual void OnPress() { cpi.Ok();  }
 };
 
 class BrightUpButton : public Pult {
 public:
     BrightUpButton(int x, int y, const char *lb, LEDCore *c)
         : Pult(x, y, lb, c) { labelsize(le365const::font_size_control_button); }
-    virtual void OnPress() { core->BrightUp(); }
+    virtual void OnPress() { cpi.Up(); }
 };
 
 class BrightDownButton : public Pult {
 public:
     BrightDownButton(int x, int y, const char *lb, LEDCore *c)
         : Pult(x, y, lb, c) { labelsize(le365const::font_size_control_button); }
-    virtual void OnPress() { core->BrightDown(); }
+    virtual void OnPress() { cpi.Down(); }
 };
 
 
@@ -97,14 +98,14 @@ class BrowseLeftButton : public Pult {
 public:
     BrowseLeftButton(int x, int y, const char *lb, LEDCore *c)
         : Pult(x, y, lb, c) { labelsize(le365const::font_size_control_button); }
-    virtual void OnPress() { core->PrevMode(); }
+    virtual void OnPress() { cpi.Left(); }
 };
 
 class BrowseRightButton : public Pult {
 public:
     BrowseRightButton(int x, int y, const char *lb, LEDCore *c)
         : Pult(x, y, lb, c) { labelsize(le365const::font_size_control_button); }
-    virtual void OnPress() { core->NextMode(); }
+    virtual void OnPress() { cpi.Right(); }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
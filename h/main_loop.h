@@ -6,18 +6,26 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 /***
-     Main loop of the programm
-                               ***/
+     Main loop of the programm (the render thread)
+                                                   ***/
 
 
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "common.h"
 #include "tcp_srv.h"
+#include "net_shards.h"
+#include "pixel_srv.h"
+#include "pult_queue.h"
+#include "event_log.h"
+#include "frame_profiler.h"
 #include "led_core.h"
 #include "oofl.h"
 
 #include <array>
+#include <atomic>
+#include <deque>
+#include <vector>
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -27,8 +35,28 @@
 class MainLoop {
     friend class Window365;
 private:
-    TcpServer *srv;
+    Selector *sel;          // Render thread's reactor: display and frame input;
+    DisplaySession *disp;   // nullptr - headless (see headless_srv.h);
+    PixelServer *pix;       // nullptr - no pixel-stream port;
+    PultQueue *commands;    // From the network thread;
+    NetShards *net;         // Network threads;
     LEDCore *core;
+    CorePultInterface cpi;
+    bool backlog;           // Commands over the frame's budget wait;
+    EventLog *events;       // nullptr - not recorded;
+    enum_mode lastMode;     // Last recorded;
+    FrameProfiler *prof;    // nullptr - not profiled;
+    // Timed commands and drawn frames, acknowledged after the frame that
+    // follows them:
+    struct Awaiting {
+        PultCommand c;
+        uint64_t frame;     // Presented when they were applied;
+    };
+    std::vector<Awaiting> awaiting;
+    // Replies a full queue of their shard has refused, in order; posted
+    // again every frame, commands wait while it is full:
+    std::deque<PultCommand> unposted;
+    std::atomic<bool> stopAsked;
     
     std::array<OOFLButton*, le365const::num_all_buttons> buttons;
     
@@ -44,20 +72,37 @@ private:
     ModeStop 				stop;                                          // O
 
     void ModeStep();
+    void CommandStep();
+    void EventStep();
+    void ReplyStep();
+    void Trace(PultCommand &c);
+    void Reply(const PultCommand &c);
+    bool RepostReplies();
+    int WaitUsec() const;
 
 public:
-    MainLoop(TcpServer *sp, LEDCore *cp) 
-    	: srv(sp), core(cp), buttons(),
+    MainLoop(Selector *sp, DisplaySession *dp, PixelServer *pp, 
+             PultQueue *qp, NetShards *np, LEDCore *cp, EventLog *ep,
+             FrameProfiler *fp) 
+    	: sel(sp), disp(dp), pix(pp), commands(qp), net(np), core(cp), cpi(),
+    	  backlog(false), events(ep), lastMode(mode_null), prof(fp), 
+    	  awaiting(), unposted(), stopAsked(false), buttons(),
     	  rainbow(cp, mode_1), rainbowMeteor(cp, mode_2), 
     	  rainbowGlitter(cp, mode_3), stars(cp, mode_4), runningDots(cp, mode_5), 
     	  pacifica(cp, mode_6), rgb(cp, mode_7), cmyk(cp, mode_8), 
-    	  white(cp, mode_9), stop(cp, mode_stop) {}
+    	  white(cp, mode_9), stop(cp, mode_stop) 
+    { 
+        cpi.Init(cp, src_network); 
+        awaiting.reserve(le365const::pult_awaiting_replies);
+    }
 
     // No copying and assignment:
     MainLoop(const MainLoop&) = delete;
     MainLoop& operator=(const MainLoop&) = delete;
     
     void Run();
+    // Any thread, Run() returns within a select timeout:
+    void Stop() { stopAsked.store(true, std::memory_order_relaxed); }
 };
 
 
@@ -0,0 +1,99 @@
+#ifndef MPSC_QUEUE_AK_H
+#define MPSC_QUEUE_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Bounded lock-free multi-producer/single-consumer queue.
+
+    Every cell carries a sequence number (D. Vyukov's bounded queue):
+    a producer claims a cell with one CAS on "head", fills it and
+    publishes it by advancing the cell's sequence; the only consumer
+    owns "tail" and needs no atomic read-modify-write at all.
+    TryPush() fails instead of blocking when the queue is full.
+                                                                ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: MpscQueue ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T, std::size_t N>
+class MpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Size must be a power of 2");
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq{ 0 };
+        T data{};
+    };
+    static constexpr std::size_t mask{ N - 1 };
+    std::array<Cell, N> cells{};
+    alignas(64) std::atomic<std::size_t> head{ 0 };    // Producers;
+    alignas(64) std::size_t tail{ 0 };                 // Consumer.
+public:
+    MpscQueue()
+    {
+        for(std::size_t i = 0; i < N; ++i) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // No copying and assignment:
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread:
+    bool TryPush(const T &v)
+    {
+        std::size_t pos{ head.load(std::memory_order_relaxed) };
+        Cell *c{ nullptr };
+        for(;;) {
+            c = &cells[pos & mask];
+            std::size_t seq{ c->seq.load(std::memory_order_acquire) };
+            auto dif{ static_cast<std::intptr_t>(seq) -
+                      static_cast<std::intptr_t>(pos) };
+            if(dif == 0) {
+                if(head.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(dif < 0) {
+                return false;                          // Full;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        c->data = v;
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only:
+    bool TryPop(T &v)
+    {
+        Cell &c{ cells[tail & mask] };
+        if(c.seq.load(std::memory_order_acquire) != tail + 1) {
+            return false;                              // Empty.
+        }
+        v = c.data;
+        c.seq.store(tail + N, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+    static constexpr std::size_t Capacity() { return N; }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
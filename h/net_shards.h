@@ -0,0 +1,84 @@
+#ifndef NET_SHARDS_AK_H
+#define NET_SHARDS_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     Network threads of the TCP-server.
+
+     Every shard is a complete reactor: its own Selector, FrameBus,
+     TcpServer with its sessions and a NetworkThread. With more than one
+     shard the listeners share the port through SO_REUSEPORT and the
+     kernel spreads new connections among them, so a reconnect storm is
+     accepted in parallel. All of the shards post into the same PultQueue,
+     the replies come back to the shard that owns the session.
+     A Unix socket of the same protocol is served by shard 0, besides
+     the TCP port or instead of it (one shard then).
+                                                                       ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "srv_logger.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+#include "frame_bus.h"
+#include "pult_queue.h"
+
+#include <memory>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: NetShards ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class NetShards {
+private:
+	struct Shard {
+		Selector sel;
+		FrameBus bus;
+		TcpServer srv;
+		std::unique_ptr<NetworkThread> thr;
+		Shard(SrvLogger *sl, PultQueue *pq, int port, bool reusePort)
+			: sel(sl), bus(&sel), 
+			  srv(TcpServer::Start(&sel, sl, &bus, pq, port, reusePort)), 
+			  thr() {}
+		Shard(SrvLogger *sl, PultQueue *pq, const char *path)
+			: sel(sl), bus(&sel), 
+			  srv(TcpServer::StartLocal(&sel, sl, &bus, pq, path)), thr() {}
+	};
+	LEDCore *core;
+	std::vector<std::unique_ptr<Shard>> shards;
+public:
+	NetShards(LEDCore *cp, SrvLogger *sl, PultQueue *pq, int port, 
+	          int count);
+	// The Unix socket only:
+	NetShards(LEDCore *cp, SrvLogger *sl, PultQueue *pq, const char *path);
+	~NetShards();
+	size_t Count() const { return shards.size(); }
+	// Shard 0 also hosts the handlers added before Start():
+	Selector* MainSelector() { return &shards.front()->sel; }
+	FrameBus* MainBus() { return &shards.front()->bus; }
+	// Seconds, 0 - off; before Start():
+	void SetTimeouts(double idleSec, double keepaliveSec, double stallSec);
+	void SetRateLimits(double cmdPerSec, double bytesPerSec);
+	// Shard i records its events as source i:
+	void SetEventLog(EventLog *el);
+	void SetProfiler(FrameProfiler *fp);
+	void ListenLocal(const char *path);
+	void Start();
+	bool Running() const;
+	// Stops the threads, rethrows the first fault of any of them:
+	void Join();
+	// No copying and assignment:
+	NetShards(const NetShards&) = delete;
+	NetShards& operator=(const NetShards&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
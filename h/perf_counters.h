@@ -0,0 +1,71 @@
+#ifndef PERF_COUNTERS_AK_H
+#define PERF_COUNTERS_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Hardware counters of the calling thread through perf_event_open(2):
+    cycles, instructions, branch misses and L1D read misses, one group
+    read by a single read() of the leader. User space only, the default
+    perf_event_paranoid of 2 allows it to an unprivileged process. A
+    counter the CPU (or the hypervisor) does not have is left out, the
+    rest still count; no counters at all is reported by Open() with
+    errno, the caller goes on without them.
+                                                                    ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum perf_counter {
+    perf_cycles,
+    perf_instructions,
+    perf_branch_misses,
+    perf_l1d_misses,
+    perf_counters
+};
+
+inline constexpr const char *perf_counter_names[ perf_counters ]{
+    "cycles", "instr", "br-miss", "L1D-miss"
+};
+
+struct PerfSample {
+    std::array<uint64_t, perf_counters> v{};
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: PerfCounters ////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class PerfCounters {
+private:
+    std::array<int, perf_counters> fds;
+    std::array<size_t, perf_counters> slots;    // Places in the group read;
+    size_t opened;
+public:
+    PerfCounters() : fds(), slots(), opened(0) { fds.fill(-1); }
+    ~PerfCounters() { Close(); }
+    // Counts the calling thread from now on; errno, 0 - at least one:
+    int Open();
+    void Close();
+    bool IsOpen() const { return opened > 0; }
+    bool Has(perf_counter c) const { return fds[c] != -1; }
+    // The running totals, 0 for a counter left out:
+    bool Read(PerfSample &s) const;
+    // No copying and assignment:
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef PIXEL_SRV_AK_H
+#define PIXEL_SRV_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     Binary pixel-stream server (Open Pixel Control alike).
+
+     Every message is an 8-byte header followed by a payload:
+       byte 0      channel (0 - broadcast, 1 - this strip)
+       byte 1      command (see enum_pixel_cmd)
+       bytes 2..3  reserved, must be 0
+       bytes 4..7  payload length, big-endian
+     The payload of pixel_set is raw RGB triplets starting at LED 0,
+     it is read straight into the LEDCore framebuffer.
+                                                      ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "srv_logger.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum enum_pixel_cmd {
+	pixel_set = 0x00,       // Present the payload as a frame;
+	pixel_release = 0x01    // Stop the live stream, resume the pattern.
+};
+
+class PixelServer;
+
+class PixelSession : private FdHandler {
+friend class PixelServer;
+private:
+	uint8_t header[ le365const::pixel_header_size ];
+	uint8_t discard[ le365const::pixel_discard_size ];
+	int hdrUsed;
+	uint8_t channel;
+	uint8_t command;
+	uint32_t payloadLen;
+	uint32_t payloadDone;
+	std::string networkDetails{};
+	PixelServer *master;
+	LEDCore *core;
+	PixelSession(PixelServer *am, int fd, LEDCore *cp);
+	virtual ~PixelSession() {}
+	virtual void Handle(bool r, bool w);
+	void Halt();
+	// False - the reserved bytes are not 0, the session is dropped:
+	bool ParseHeader();
+	void ReadPayload(uint8_t *&dst, size_t &len);
+	// True - a frame is committed in the live buffer; the rest of the
+	// stream waits for the render loop to show it (select() reports it
+	// again), the next payload would be read over it:
+	bool FinishMessage();
+	// No copying and assignment:
+	PixelSession(const PixelSession&) = delete;
+	PixelSession& operator=(const PixelSession&) = delete;
+};
+
+class PixelServer : public FdHandler {
+friend class PixelSession;
+private:
+	Selector *sel;
+	SrvLogger *slg;
+	LEDCore *lcp;
+	std::list<PixelSession*> garblist;
+	TcpCounters counters;
+	AcceptLoop acceptor;
+	PixelServer(Selector *aFds, LEDCore *cp, SrvLogger *sl, int fdSrv);
+public:
+	// Optional (--pixel), so it is made on the heap:
+	static PixelServer* Start(Selector *sp, LEDCore *cp,
+	                          SrvLogger *sl, int port);
+	virtual ~PixelServer();
+	virtual void Handle(bool r, bool w);
+	void RemovePixelSession(PixelSession *s);
+	void GarbCollect();
+	// No copying and assignment:
+	PixelServer(const PixelServer&) = delete;
+	PixelServer& operator=(const PixelServer&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef PULT_QUEUE_AK_H
+#define PULT_QUEUE_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     Hand-over of the pult commands between the threads.
+
+     The network thread posts PultCommand's into the render loop's queue,
+     MainLoop drains it once per iteration into CorePultInterface and
+     posts every network command back to its "replyTo" queue, which the
+     network thread drains to answer the session. Posting never blocks:
+     Post() returns false when the queue is full. An eventfd doorbell,
+     rung only on the first post after a drain, wakes the consumer.
+                                                                     ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "led_core.h"
+#include "mpsc_queue.h"
+#include "tcp_srv.h"
+
+#include <atomic>
+#include <functional>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: PultQueue ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class PultQueue : public FdHandler {
+private:
+	Selector *sel;
+	MpscQueue<PultCommand, le365const::pult_queue_size> queue;
+	std::atomic<bool> rung;
+	std::function<void()> onWake;
+public:
+	// "wake" runs on the consumer thread after the doorbell:
+	PultQueue(Selector *sp, std::function<void()> wake = {}); // Throws 
+	                                                        // system_error;
+	virtual ~PultQueue();
+	virtual void Handle(bool r, bool w);
+	// Any thread:
+	bool Post(const PultCommand &c);
+	// Consumer thread only:
+	bool Take(PultCommand &c) { return queue.TryPop(c); }
+	// No copying and assignment:
+	PultQueue(const PultQueue&) = delete;
+	PultQueue& operator=(const PultQueue&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
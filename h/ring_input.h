@@ -0,0 +1,88 @@
+#ifndef RING_INPUT_AK_H
+#define RING_INPUT_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Emulator side of the shared-memory frame ring (see shm_ring.h):
+    a Unix socket for the producer handshake and an eventfd doorbell,
+    both served by the Selector.
+                                ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "srv_logger.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+#include "shm_ring.h"
+
+#include <list>
+#include <string>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+class RingInput;
+
+class RingDoorbell : public FdHandler {
+private:
+	RingInput *master;
+public:
+	RingDoorbell(RingInput *am, int efd) : FdHandler(efd, true), master(am) {}
+	virtual void Handle(bool r, bool w);
+	// No copying and assignment:
+	RingDoorbell(const RingDoorbell&) = delete;
+	RingDoorbell& operator=(const RingDoorbell&) = delete;
+};
+
+class RingLink : public FdHandler {
+private:
+	RingInput *master;
+public:
+	RingLink(RingInput *am, int fd) : FdHandler(fd, true), master(am) {}
+	virtual void Handle(bool r, bool w);
+	// No copying and assignment:
+	RingLink(const RingLink&) = delete;
+	RingLink& operator=(const RingLink&) = delete;
+};
+
+class RingInput : public FdHandler {
+private:
+	Selector *sel;
+	SrvLogger *slg;
+	LEDCore *lcp;
+	std::string path;
+	std::string shmName;
+	RingLink *link;
+	RingDoorbell *bell;
+	ShmRingHeader *hdr;
+	uint8_t *slots;
+	size_t mapSize;
+	// Ours, the producer can write the header's copies:
+	uint32_t slotCount;
+	uint32_t slotSize;
+	std::list<FdHandler*> garblist;
+	RingInput(Selector *aFds, LEDCore *cp, SrvLogger *sl,
+	          const char *aPath, int fdSrv);
+	bool Attach(int fd);
+	void GarbCollect();
+public:
+	// Optional, so it is made on the heap:
+	static RingInput* Start(Selector *sp, LEDCore *cp, SrvLogger *sl,
+	                        const char *path);
+	virtual ~RingInput();
+	virtual void Handle(bool r, bool w);
+	void Doorbell();
+	void Detach();
+	// No copying and assignment:
+	RingInput(const RingInput&) = delete;
+	RingInput& operator=(const RingInput&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SHM_EXPORT_AK_H
+#define SHM_EXPORT_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Publishing of every presented frame 
+    into a POSIX shared-memory segment (see shm_frame.h)
+                                                        ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "led_core.h"
+#include "shm_frame.h"
+
+#include <string>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ShmFramePublisher : public FrameSink {
+private:
+    std::string name;
+    ShmFrameHeader *hdr;
+    uint8_t *pixels;
+    size_t mapSize;
+public:
+    // Creates (or takes over) the segment, throws std::system_error:
+    ShmFramePublisher(const char *shmName, uint32_t numLeds);
+    virtual ~ShmFramePublisher();
+    virtual void OnFrame(const CRGB *leds, size_t count, 
+                         const FrameInfo &info);
+    
+    // No copying and assignment:
+    ShmFramePublisher(const ShmFramePublisher&) = delete;
+    ShmFramePublisher& operator=(const ShmFramePublisher&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
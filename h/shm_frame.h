@@ -0,0 +1,101 @@
+#ifndef SHM_FRAME_AK_H
+#define SHM_FRAME_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Layout of the shared-memory framebuffer segment and a tiny reader
+    library for the external tools (no FLTK, no LEDCore needed).
+
+    The segment is a ShmFrameHeader followed by numLeds RGB triplets.
+    The writer keeps "seq" odd while the frame is being updated,
+    so a reader copies the frame and retries if "seq" has changed.
+                                                                 ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace le365shm {
+    inline constexpr uint32_t magic{ 0x3536334C };  // "L365"
+    inline constexpr uint32_t version{ 1 };
+    inline constexpr std::string_view default_name{ "/le365_frame" };
+}
+
+struct ShmFrameHeader {
+    uint32_t magic{ 0 };
+    uint32_t version{ 0 };
+    uint32_t headerSize{ 0 };    // Offset of the pixels from the segment start;
+    uint32_t numLeds{ 0 };
+    std::atomic<uint64_t> seq{ 0 };
+    uint64_t frameCounter{ 0 };
+    uint64_t timestampNs{ 0 };   // CLOCK_MONOTONIC at presentation;
+    int32_t mode{ 0 };
+    int32_t bright{ 0 };
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Seqlock counter must be lock-free to be shared");
+
+size_t shm_frame_segment_size(uint32_t numLeds);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: ShmFrameReader //////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+struct ShmFrame {
+    uint64_t frameCounter{ 0 };
+    uint64_t timestampNs{ 0 };
+    int32_t mode{ 0 };
+    int32_t bright{ 0 };
+    std::vector<uint8_t> rgb{};   // numLeds * 3 bytes;
+};
+
+class ShmFrameReader {
+private:
+    const ShmFrameHeader *hdr;
+    const uint8_t *pixels;
+    size_t mapSize;
+    uint32_t numLeds;           // Checked against the mapping by Open();
+public:
+    ShmFrameReader() : hdr(nullptr), pixels(nullptr), mapSize(0), 
+                       numLeds(0) {}
+    ~ShmFrameReader() { Close(); }
+
+    // No copying and assignment:
+    ShmFrameReader(const ShmFrameReader&) = delete;
+    ShmFrameReader& operator=(const ShmFrameReader&) = delete;
+
+    bool Open(const char *name);
+    void Close();
+    bool IsOpen() const { return hdr != nullptr; }
+    uint32_t NumLeds() const { return numLeds; }
+
+    // Cheap check for a new frame, no copy:
+    uint64_t LastFrame() const;
+    // Copies a consistent frame, false if the writer kept it busy for
+    // maxRetries attempts (or died in the middle of a write):
+    bool Read(ShmFrame &out, int maxRetries = 1000) const;
+
+    // Zero-copy access: read the pixels in place between BeginRead()
+    // and EndRead(), the data is valid only if EndRead() returns true;
+    // BeginRead() does not wait out a write, the caller bounds its retries.
+    uint64_t BeginRead() const;
+    bool EndRead(uint64_t seq) const;
+    const uint8_t* Pixels() const { return pixels; }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
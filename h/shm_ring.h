@@ -0,0 +1,88 @@
+#ifndef SHM_RING_AK_H
+#define SHM_RING_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Single-producer/single-consumer frame ring in shared memory,
+    the input side of the emulator (see shm_frame.h for the output).
+
+    Handshake: the producer connects to the emulator's Unix socket and
+    receives the segment name as a text line with an eventfd attached
+    (SCM_RIGHTS). It renders straight into the free slot, publishes it
+    by advancing "head" and rings the eventfd doorbell. The emulator
+    presents the newest published slot in place and advances "tail".
+    Closing the socket hands the strip back to the pattern engine.
+                                                                  ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace le365shm {
+    inline constexpr uint32_t ring_magic{ 0x5236334C };    // "L36R"
+    inline constexpr uint32_t ring_version{ 1 };
+    inline constexpr uint32_t ring_slots{ 4 };
+    inline constexpr std::string_view ring_default_path{
+        "/tmp/le365_ring.sock" };
+    inline constexpr std::string_view ring_shm_prefix{ "/le365_ring_" };
+    inline constexpr size_t ring_name_max{ 255 };
+}
+
+struct ShmRingHeader {
+    uint32_t magic{ 0 };
+    uint32_t version{ 0 };
+    uint32_t headerSize{ 0 };    // Offset of slot 0 from the segment start;
+    uint32_t numLeds{ 0 };
+    uint32_t slotCount{ 0 };
+    uint32_t slotSize{ 0 };      // numLeds * 3 bytes;
+    // Producer and consumer counters live on their own cache lines:
+    alignas(64) std::atomic<uint64_t> head{ 0 };     // Frames published;
+    alignas(64) std::atomic<uint64_t> tail{ 0 };     // Frames consumed.
+};
+
+size_t shm_ring_segment_size(uint32_t numLeds, uint32_t slots);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: ShmRingProducer /////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class ShmRingProducer {
+private:
+    int sock;
+    int bell;
+    ShmRingHeader *hdr;
+    uint8_t *slots;
+    size_t mapSize;
+public:
+    ShmRingProducer() : sock(-1), bell(-1), hdr(nullptr),
+                        slots(nullptr), mapSize(0) {}
+    ~ShmRingProducer() { Close(); }
+
+    // No copying and assignment:
+    ShmRingProducer(const ShmRingProducer&) = delete;
+    ShmRingProducer& operator=(const ShmRingProducer&) = delete;
+
+    bool Connect(const char *path);
+    void Close();
+    uint32_t NumLeds() const { return hdr ? hdr->numLeds : 0; }
+
+    // Free slot to render the next frame into, nullptr if the ring is full:
+    uint8_t* AcquireSlot();
+    // Publishes the acquired slot and rings the doorbell:
+    void Publish();
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef SLAB_POOL_AK_H
+#define SLAB_POOL_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Object pool of preallocated slabs with generation-checked handles.
+
+    Objects are constructed in place in the slots of fixed-size chunks;
+    a freed slot goes to a free list and is reused by the next Create(),
+    so the churn of objects calls the allocator only when the pool grows
+    past its high-water mark. A handle is the slot index and the slot's
+    generation: Release() bumps the generation at once, a stale handle
+    (e.g. of a reply still in flight) finds nothing. The released object
+    itself lives on until Collect(), which is a no-op when none is pending.
+                                                                        ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: SlabPool ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T, std::size_t ChunkSize = 64>
+class SlabPool {
+    static_assert(ChunkSize > 0, "Empty chunks");
+private:
+    enum slot_state { slot_free, slot_live, slot_pending };
+    struct Slot {
+        alignas(T) unsigned char storage[ sizeof(T) ];
+        uint32_t gen;
+        slot_state state;
+    };
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> pending;       // Released, not yet destroyed;
+    std::size_t live;
+
+    Slot& At(uint32_t i) const { return chunks[i / ChunkSize][i % ChunkSize]; }
+    static T* Object(Slot &s)
+    {
+        return std::launder(reinterpret_cast<T*>(s.storage));
+    }
+    static uint64_t MakeHandle(uint32_t i, uint32_t gen)
+    {
+        return uint64_t{ gen } << 32 | i;
+    }
+    void Grow()
+    {
+        auto first{ static_cast<uint32_t>(chunks.size() * ChunkSize) };
+        chunks.push_back(std::make_unique<Slot[]>(ChunkSize));
+        // Both lists hold every slot at most, push_back() never allocates:
+        freeSlots.reserve(chunks.size() * ChunkSize);
+        pending.reserve(chunks.size() * ChunkSize);
+        for(std::size_t i = ChunkSize; i-- > 0;) {
+            Slot &s{ chunks.back()[i] };
+            s.gen = 1;                          // Handle 0 is never valid;
+            s.state = slot_free;
+            freeSlots.push_back(first + static_cast<uint32_t>(i));
+        }
+    }
+    void Destroy(uint32_t i)
+    {
+        Slot &s{ At(i) };
+        Object(s)->~T();
+        s.state = slot_free;
+        freeSlots.push_back(i);
+    }
+
+public:
+    explicit SlabPool(std::size_t reserve = ChunkSize)
+        : chunks(), freeSlots(), pending(), live(0)
+    {
+        while(chunks.size() * ChunkSize < reserve) { Grow(); }
+    }
+    ~SlabPool()
+    {
+        Collect();
+        ForEach([](T *p) { p->~T(); });
+    }
+
+    // No copying and assignment:
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // Constructs an object in a free slot, "h" receives its handle:
+    template <typename... Args>
+    T* Create(uint64_t &h, Args&&... args)
+    {
+        if(freeSlots.empty()) { Grow(); }
+        uint32_t i{ freeSlots.back() };
+        Slot &s{ At(i) };
+        T *p{ ::new(static_cast<void*>(s.storage))
+                  T(std::forward<Args>(args)...) };
+        freeSlots.pop_back();
+        s.state = slot_live;
+        ++live;
+        h = MakeHandle(i, s.gen);
+        return p;
+    }
+
+    // nullptr for a released or a stale handle:
+    T* Get(uint64_t h) const
+    {
+        auto i{ static_cast<uint32_t>(h) };
+        if(i >= chunks.size() * ChunkSize) { return nullptr; }
+        Slot &s{ At(i) };
+        if(s.state != slot_live || s.gen != static_cast<uint32_t>(h >> 32)) {
+            return nullptr;
+        }
+        return Object(s);
+    }
+
+    // The handle dies now, the object on the next Collect():
+    bool Release(uint64_t h)
+    {
+        if(!Get(h)) { return false; }
+        auto i{ static_cast<uint32_t>(h) };
+        Slot &s{ At(i) };
+        s.state = slot_pending;
+        if(++s.gen == 0) { s.gen = 1; }
+        pending.push_back(i);
+        --live;
+        return true;
+    }
+
+    void Collect()
+    {
+        if(pending.empty()) [[likely]] { return; }
+        for(uint32_t i : pending) { Destroy(i); }
+        pending.clear();
+    }
+
+    template <typename F>
+    void ForEach(F f)
+    {
+        for(uint32_t i = 0; i < chunks.size() * ChunkSize; ++i) {
+            if(At(i).state == slot_live) { f(Object(At(i))); }
+        }
+    }
+
+    std::size_t Live() const { return live; }
+    std::size_t Capacity() const { return chunks.size() * ChunkSize; }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -2,41 +2,134 @@
 #define LOGGER_AK_H
 
 
-#define BOOST_LOG_DYN_LINK
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     Logger for the LE365 TCP-server.
+
+     Asynchronous: a log call only stamps the time, copies its arguments
+     into a record and pushes it into a lock-free MPSC queue. A background
+     thread formats the records, writes each batch to the file and to the
+     console with one call and flushes it once. Log() defers printf-style
+     formatting to that thread ("fmt" must be a string literal, string
+     arguments are copied). On a full queue the record is dropped and
+     counted or the caller waits, by the policy.
+     File format: "dd-mm-YYYY / HH:MM:SS:uuuuuu -> message".
+                                                                      ***/
 
 
 ////////////////////////////////////////////////////////////////////////////////
 
-/***
-     Logger for the LE365 TCP-server
-                                     ***/
+#include "mpsc_queue.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
 
 
 ////////////////////////////////////////////////////////////////////////////////
 
-#include <boost/log/sources/logger.hpp>
-#include <boost/log/sources/record_ostream.hpp>
-#include <boost/log/expressions.hpp>
-#include <boost/log/support/date_time.hpp>
-#include <boost/log/utility/setup/console.hpp>
-#include <boost/log/utility/setup/file.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
+enum log_overflow { log_drop, log_block };
 
+// A log call as captured by the caller, formatted later:
+struct LogRecord {
+    static constexpr size_t max_args{ 8 };
+    static constexpr size_t text_size{ 384 };
+    enum arg_kind : uint8_t { arg_int, arg_uint, arg_double, arg_str };
+    int64_t usec{ 0 };                   // System clock, since the epoch;
+    const char *fmt{ nullptr };          // nullptr - "text" is the message;
+    uint8_t count{ 0 };
+    std::array<arg_kind, max_args> kinds{};
+    std::array<uint64_t, max_args> args{};      // arg_str: offset in "text";
+    uint16_t used{ 0 };
+    std::array<char, text_size> text{};
+};
 
-namespace logging = boost::log;
-namespace src = boost::log::sources;
-namespace expr = boost::log::expressions;
-namespace bptm = boost::posix_time;
+// "dd-mm-YYYY / HH:MM:SS:uuuuuu -> " of the system clock's microseconds:
+void log_stamp(int64_t usec, std::string &out);
 
 
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: SrvLogger ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 class SrvLogger {
 private:
-    src::logger lg;
+    static constexpr size_t queue_size{ 1024 };  // Power of 2;
+    std::unique_ptr<MpscQueue<LogRecord, queue_size>> queue;  // 0.5 MiB;
+    std::FILE *file;
+    log_overflow policy;
+    std::atomic<uint32_t> posted;        // Doorbell of the writer thread;
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> stop;
+    std::thread writer;
+    static int64_t NowUsec();
+    bool Push(const LogRecord &r);
+    void AddText(LogRecord &r, const char *s);
+    template <typename T>
+    void AddArg(LogRecord &r, const T &v);
+    void Run();
+    static void Format(const LogRecord &r, std::string &out);
 public:
-    SrvLogger(const char *file_name);
+    explicit SrvLogger(const char *file_name, log_overflow p = log_drop);
+    // Writes out everything logged before:
+    ~SrvLogger();
     bool WriteLog(const char *msg);
+    // printf-like, formatted on the writer thread:
+    template <typename... Args>
+    bool Log(const char *fmt, const Args&... args);
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+    // No copying and assignment:
+    SrvLogger(const SrvLogger&) = delete;
+    SrvLogger& operator=(const SrvLogger&) = delete;
 };
 
+template <typename T>
+void SrvLogger::AddArg(LogRecord &r, const T &v)
+{
+    if constexpr(std::is_enum_v<T>) {
+        AddArg(r, static_cast<std::underlying_type_t<T>>(v));
+    } else {
+        if(r.count == LogRecord::max_args) { return; }
+        size_t i{ r.count++ };
+        if constexpr(std::is_convertible_v<const T&, const char*>) {
+            r.kinds[i] = LogRecord::arg_str;
+            r.args[i] = r.used;
+            AddText(r, v);
+        } else if constexpr(std::is_floating_point_v<T>) {
+            r.kinds[i] = LogRecord::arg_double;
+            double d{ static_cast<double>(v) };
+            std::memcpy(&r.args[i], &d, sizeof(d));
+        } else if constexpr(std::is_signed_v<T>) {
+            r.kinds[i] = LogRecord::arg_int;
+            r.args[i] = static_cast<uint64_t>(static_cast<int64_t>(v));
+        } else {
+            static_assert(std::is_integral_v<T>,
+                          "Log() takes numbers and strings");
+            r.kinds[i] = LogRecord::arg_uint;
+            r.args[i] = static_cast<uint64_t>(v);
+        }
+    }
+}
+
+template <typename... Args>
+bool SrvLogger::Log(const char *fmt, const Args&... args)
+{
+    LogRecord r{};
+    r.usec = NowUsec();
+    r.fmt = fmt;
+    (AddArg(r, args), ...);
+    return Push(r);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #endif
@@ -13,9 +13,15 @@
 
 #include "common.h"
 #include "srv_logger.h"
+#include "event_log.h"
+#include "frame_profiler.h"
 #include "led_core.h"
+#include "slab_pool.h"
+#include "timer_wheel.h"
+#include "token_bucket.h"
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <errno.h>
@@ -23,11 +29,16 @@
 #include <arpa/inet.h>
 #include <string.h>
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <exception>
 #include <functional>
+#include <memory>
+#include <thread>
 #include <unordered_map>
 #include <list>
+#include <vector>
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -57,7 +68,9 @@ public:
 	~Selector() { if(fdArray) delete[] fdArray; }
 	void Add(FdHandler *fdh);
 	bool Remove(FdHandler *fdh);
-	void Select();
+	void Select() { Select(le365const::select_delay_sec * 1000000 + 
+	                       le365const::select_delay_usec); }
+	void Select(int waitUsec);
     // No copying and assignment:
     Selector(const Selector&) = delete;
     Selector& operator=(const Selector&) = delete;	
@@ -68,69 +81,264 @@ public:
 
 class TcpServer;
 class TcpSession;
+class FrameBus;
+class PultQueue;
 
-typedef std::function<void()> HandleFn;
+typedef void (*HandleFn)(TcpSession &s, const char *args);
+// cmd_bare - a line with arguments gets the usage, not the command:
+enum enum_cmd_args { cmd_bare, cmd_args };
+struct CommandEntry {
+	enum_cmd_args args;
+	HandleFn fn;
+};
+// Parses the arguments and paints, false (nothing painted) if they are bad:
+typedef bool (*DrawFn)(CRGB *leds, const char *args);
 
 
-class TcpSession : private FdHandler {
+class TcpSession : private FdHandler, private FrameSubscriber, 
+                   private WheelTimer {
 friend class TcpServer;
+friend class SlabPool<TcpSession>;
 private:
 	char buffer[ le365const::tcp_line_max_length + 1 ];
 	int bufUsed;
 	bool ignoring;
-	std::string networkDetails{};
+	char networkDetails[ INET_ADDRSTRLEN + 6 ];  // "address:port";
+	std::string outBuf{};                 // Not yet accepted by the socket;
 	TcpServer *master;
-	CorePultInterface cpi;
-	std::unordered_map<std::string, HandleFn> handleMap; // For branching, 
-	                                                     // see the constructor.
-	TcpSession(TcpServer *am, int fd, LEDCore *cp);
+	uint64_t id;                          // Pool handle, key for the replies;
+	// Shared by all the sessions, for branching, see tcp_srv.cpp:
+	static const std::unordered_map<std::string_view, CommandEntry> handleMap;
+	// Frame subscription:
+	bool subscribed;
+	bool subBehind;                       // Skipped a frame, socket was busy;
+	double subInterval;                   // Decimation, seconds per frame;
+	Timer subTimer;
+	std::vector<CRGB> subPrev;            // Last frame sent, for deltas;
+	uint64_t subSinceKey;
+	// Timeouts, in ticks of the server's wheel; one timer for all three,
+	// it is moved lazily when it fires:
+	uint64_t lastActive;                  // Input or a frame sent;
+	uint64_t lastSent;
+	uint64_t stallSince;                  // Output pending, no progress;
+	bool reset;                           // The peer has reset the connection;
+	// Admission: over a limit the input waits, TCP pushes back the client:
+	TokenBucket cmdBucket;
+	TokenBucket byteBucket;
+	bool paused;                          // Not reading until "pausedUntil";
+	uint64_t pausedUntil;
+	uint64_t throttled;                   // Times held back;
+	// Drawing commands paint the session's own frame; each one presents
+	// it, in a "begin"/"commit" batch only the commit does:
+	std::array<CRGB, le365const::num_leds> canvas;
+	bool inBatch;
+	int batchBright;                      // "bri" of the batch or -1;
+	bool timed;                           // "latency on", see PultDone();
+	TcpSession(TcpServer *am, int fd);
 	virtual ~TcpSession() {}
 	virtual void Handle(bool r, bool w);
+	virtual bool WantRead() const { return !paused; }
+	virtual bool WantWrite() const { return !outBuf.empty(); }
 	void Halt();
+	bool Live() const;
+	void Pause(double sec, bool forCommands);
 	void Say(const char *msg);
+	void Send(const char *data, size_t len);
+	void Flush();
+	void Subscribe(const char *args);
+	void Unsubscribe();
+	void Pult(enum_pult_cmd cmd, enum_mode m = mode_null);
+	void Pult(const PultCommand &c);
+	void PultDone(const PultCommand &c);
+	void Draw(DrawFn f, const char *args, const char *usage);
+	void Bright(const char *args);
+	void Begin();
+	void Commit();
+	void PostCanvas(enum_pult_cmd cmd, int bright);
+	void QueryStatus();
+	void QueryFrame(const char *args);
+	void QueryHash();
+	void QueryStats(const char *args);
+	void QueryTrace(const char *args);
+	void TraceDone(const PultCommand &c);
+	void Latency(const char *args);
+	virtual void OnBusFrame(const CRGB *leds, size_t count, 
+	                        const FrameInfo &info);
+	void SendFrame(const CRGB *leds, size_t count, const FrameInfo &info);
 	void ReadAndIgnore();
 	void ReadAndCheck();
 	void CheckLines();
 	void ProcessLine(const char *str);
 	void ServerAnswer(const char *str);
+	virtual void OnTimer();
+	void Rearm();
 	// No copying and assignment:
     TcpSession(const TcpSession&) = delete;
     TcpSession& operator=(const TcpSession&) = delete;
 };
 
-class DisplaySession : private FdHandler {
-friend class TcpServer;
+// X11 connection of FLTK, belongs to the render thread's Selector:
+class DisplaySession : public FdHandler {
 private:
+	Selector *sel;
 	bool windowClosed;
-	DisplaySession(int fd) : FdHandler(fd, false), windowClosed(false) {}
-	virtual ~DisplaySession() {}
+public:
+	DisplaySession(Selector *sp, int fd) 
+		: FdHandler(fd, false), sel(sp), windowClosed(false) { sel->Add(this); }
+	virtual ~DisplaySession() { sel->Remove(this); }
 	virtual void Handle(bool r, bool w);
+	bool WindowClosed() const { return windowClosed; }
+	// No copying and assignment:
+    DisplaySession(const DisplaySession&) = delete;
+    DisplaySession& operator=(const DisplaySession&) = delete;
+};
+
+// Overload is counted, not fatal; may be read from any thread:
+struct TcpCounters {
+	std::atomic<uint64_t> accepted{ 0 };
+	std::atomic<uint64_t> shed{ 0 };      // Closed at once, no resources;
+	std::atomic<uint64_t> reset{ 0 };     // Ended by the peer's reset;
+	std::atomic<uint64_t> throttledCmds{ 0 };  // Over the command rate;
+	std::atomic<uint64_t> throttledBytes{ 0 }; // Over the input byte rate;
+	std::atomic<uint64_t> throttledSessions{ 0 };
+};
+
+// Removes "path" if it is a Unix socket nobody listens on, left by a run
+// that crashed; false - another file, or the socket of a running instance:
+bool unlink_stale_socket(const char *path);
+
+// The non-blocking accept4() loop of a listener, the same for the TCP,
+// pixel-stream and WebSocket servers: an error of one peer skips it, out
+// of descriptors or memory the connections are shed (accepted and closed
+// at once, a spare descriptor makes room for it); only a broken listener
+// throws. The listener must be non-blocking:
+class AcceptLoop {
+private:
+	SrvLogger *slg;
+	const char *name;                     // Of the server, in the log;
+	TcpCounters *counters;                // accepted, shed, reset;
+	int reserveFd;                        // Spare descriptor, see Shed();
+	bool shedding;
+	std::function<void(const char*)> onShed;
+	bool Shed(int ls);
+public:
+	AcceptLoop(SrvLogger *sl, const char *aName, TcpCounters *tc);
+	~AcceptLoop();
+	// The next connection, non-blocking; -1 - none until the next wakeup:
+	int Next(int ls, sockaddr_storage &addr);
+	// Closes a connection there are no resources for:
+	void Drop(int sd, const char *why);
+	// A connection was taken; true - it ends the shedding:
+	bool Accepted();
+	void StartShedding(const char *why);
+	void OnShed(std::function<void(const char*)> f) { onShed = std::move(f); }
+	// select() can not watch a descriptor beyond FD_SETSIZE:
+	static bool Watchable(int sd) { return sd < FD_SETSIZE; }
+	// No copying and assignment:
+	AcceptLoop(const AcceptLoop&) = delete;
+	AcceptLoop& operator=(const AcceptLoop&) = delete;
 };
 
+// Unix stream socket of a TcpServer, the same sessions and commands for
+// the local tooling without the TCP stack, see TcpServer::ListenLocal():
+class LocalListener : public FdHandler {
+private:
+	Selector *sel;
+	TcpServer *master;
+	std::string path;
+public:
+	LocalListener(Selector *sp, TcpServer *am, int fd, const char *aPath);
+	virtual ~LocalListener();
+	virtual void Handle(bool r, bool w);
+	// No copying and assignment:
+	LocalListener(const LocalListener&) = delete;
+	LocalListener& operator=(const LocalListener&) = delete;
+};
+
+// Runs on the network thread, LEDCore is reached only through "commands";
+// listens a TCP port or a Unix socket (Start(), StartLocal()) or both:
 class TcpServer : public FdHandler {
+friend class TcpSession;
 private:
-	DisplaySession disp;
 	Selector *sel;
 	SrvLogger *slg;
-	LEDCore *lcp;
-	std::list<TcpSession*> garblist;
+	FrameBus *bus;
+	PultQueue *commands;
+	std::unique_ptr<PultQueue> replies;
+	SlabPool<TcpSession> sessions;        // Removed ones wait for GarbCollect();
+	TimerWheel timers;
+	uint64_t idleTicks;                   // 0 - no such timeout;
+	uint64_t keepaliveTicks;
+	uint64_t stallTicks;
+	TcpCounters counters;
+	double cmdRate, cmdBurst;             // 0 - not limited;
+	double byteRate, byteBurst;
+	std::string localPath;                // The own socket is a Unix one;
+	std::unique_ptr<LocalListener> local; // Besides the own socket;
+	EventLog *events;                     // nullptr - not recorded;
+	uint16_t source;                      // Shard number in the events;
+	FrameProfiler *profiler;       // Render thread's, "stats" and "trace";
+	AcceptLoop acceptor;                  // Of the own and the local socket;
 	bool serverStop;
-	TcpServer(int fdDisp, Selector *aFds, 
-	          LEDCore *cp, SrvLogger *sl, int fdSrv);
+	TcpServer(Selector *aFds, SrvLogger *sl, FrameBus *fb, PultQueue *pq, 
+	          int fdSrv, const char *aLocalPath = "");
     void GarbCollect();
+    void DeliverReplies();
+	static int LocalSocket(SrvLogger *sl, const char *path);
+	void AddTcpSession(int sd, const sockaddr_storage &addr);
+	void Event(event_id ev, uint64_t session, uint32_t arg = 0, 
+	           uint32_t arg2 = 0, const char *text = nullptr)
+	{ if(events) { events->Put(ev, session, source, arg, arg2, text); } }
 public:
-	static TcpServer Start(int display, Selector *sp, LEDCore *cp, 
-	                       SrvLogger *sl, int port);
+	static TcpServer Start(Selector *sp, SrvLogger *sl, FrameBus *fb, 
+	                       PultQueue *pq, int port, bool reusePort = false);
+	static TcpServer StartLocal(Selector *sp, SrvLogger *sl, FrameBus *fb, 
+	                            PultQueue *pq, const char *path);
+	FrameBus* GetBus() { return bus; }
 	virtual ~TcpServer();
 	virtual void Handle(bool r, bool w);
+	// Accepts every pending connection of the listener "ls":
+	void Accept(int ls);
+	// A Unix socket besides the own one; before the network thread starts:
+	void ListenLocal(const char *path);
 	void RemoveTcpSession(TcpSession *s);
+	const TcpCounters& Counters() const { return counters; }
+	// Stamps the command on arrival, "timed" - acknowledged once presented:
+	bool PostCommand(const PultCommand &c, bool timed);
+	// Seconds, 0 - off; before the network thread starts:
+	void SetTimeouts(double idleSec, double keepaliveSec, double stallSec);
+	// Per session, 0 - off; the bursts keep their length in seconds:
+	void SetRateLimits(double cmdPerSec, double bytesPerSec);
+	// Connects, commands, throttling; before the network thread starts:
+	void SetEventLog(EventLog *el, uint16_t aSource);
+	void SetProfiler(FrameProfiler *fp) { profiler = fp; }
 	void ServerStep();
-	bool ServerReady() const { return (!disp.windowClosed && !serverStop); }
+	bool ServerReady() const { return !serverStop; }
 	// No copying and assignment:
     TcpServer(const TcpServer&) = delete;
     TcpServer& operator=(const TcpServer&) = delete;	
 };
 
+// Serves the network Selector (TcpServer, FrameBus, WsServer) until
+// destroyed, Join() hands a fault of the thread over to the caller:
+class NetworkThread {
+private:
+	TcpServer *srv;
+	std::atomic<bool> stop;
+	std::atomic<bool> running;
+	std::exception_ptr fault;
+	std::thread thr;
+	void Run();
+public:
+	NetworkThread(TcpServer *sp);
+	~NetworkThread();
+	bool Running() const { return running.load(std::memory_order_relaxed); }
+	void Join();
+	// No copying and assignment:
+    NetworkThread(const NetworkThread&) = delete;
+    NetworkThread& operator=(const NetworkThread&) = delete;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 class TcpServerFault : public std::exception {
@@ -13,6 +13,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <chrono>
+#include <cstdint>
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -28,6 +29,12 @@ public:
    double Elapsed() const {
       return std::chrono::duration_cast<second_t>(clock_t::now()-start).count();
    }
+   // The same clock as a bare number, for the scoped timers of the profiler:
+   static uint64_t NowNs() {
+      return static_cast<uint64_t>(
+         std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_t::now().time_since_epoch()).count());
+   }
 };
 
 
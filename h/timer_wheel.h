@@ -0,0 +1,96 @@
+#ifndef TIMER_WHEEL_AK_H
+#define TIMER_WHEEL_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Hierarchical timer wheel of a reactor thread.
+
+    Four levels of 64 slots, a slot is a list of intrusive timer nodes,
+    so Schedule() and Cancel() are O(1) and allocate nothing. Level 0
+    holds the timers due within 64 ticks, the upper levels cascade down
+    when the lower one wraps. Advance() catches up with the clock after
+    every Select(), WaitUsec() shortens the reactor's wait to the next
+    occupied slot. With no timer armed both are a couple of instructions.
+                                                                       ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TimerWheel;
+
+struct WheelLink {
+    WheelLink *prev{ nullptr };
+    WheelLink *next{ nullptr };
+};
+
+// Derive and override OnTimer(); a timer fires once per Schedule():
+class WheelTimer : private WheelLink {
+friend class TimerWheel;
+private:
+    uint64_t expire{ 0 };
+public:
+    WheelTimer() = default;
+    virtual ~WheelTimer() {}
+    virtual void OnTimer() = 0;
+    bool Armed() const { return next != nullptr; }
+    uint64_t Expire() const { return expire; }
+    // No copying and assignment:
+    WheelTimer(const WheelTimer&) = delete;
+    WheelTimer& operator=(const WheelTimer&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: TimerWheel //////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class TimerWheel {
+private:
+    typedef std::chrono::steady_clock clock_t;
+    static constexpr int level_bits{ 6 };
+    static constexpr int num_levels{ 4 };
+    static constexpr uint64_t num_slots{ 1u << level_bits };
+    static constexpr uint64_t slot_mask{ num_slots - 1 };
+    std::array<std::array<WheelLink, num_slots>, num_levels> wheel;
+    clock_t::time_point start;
+    int tickUsec;
+    uint64_t now;                        // Ticks since start;
+    size_t armed;
+    void Place(WheelTimer *t);
+    static void Unlink(WheelLink *l);
+    void Cascade(int level);
+    void Fire(WheelLink &slot);
+public:
+    explicit TimerWheel(int tickMsec);
+
+    // No copying and assignment:
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    uint64_t Now() const { return now; }
+    double NowSec() const { return static_cast<double>(now) * tickUsec * 1e-6; }
+    uint64_t Ticks(double sec) const;
+    // Rearms an armed timer, "ticks" from now (at least one):
+    void Schedule(WheelTimer *t, uint64_t ticks);
+    void Cancel(WheelTimer *t);
+    // Fires every timer that is due by the clock:
+    void Advance();
+    // Reactor's wait: until the next occupied slot, at most "cap":
+    int WaitUsec(int cap) const;
+    size_t Armed() const { return armed; }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
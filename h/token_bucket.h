@@ -0,0 +1,67 @@
+#ifndef TOKEN_BUCKET_AK_H
+#define TOKEN_BUCKET_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Token bucket: "rate" tokens per second, at most "burst" in store.
+    Take() may run the bucket into debt, Wait() tells how long it takes
+    to pay it off; the caller holds the traffic back meanwhile.
+    Rate 0 is no limit at all.
+                                                               ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: TokenBucket /////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class TokenBucket {
+private:
+    double rate;
+    double burst;
+    double tokens;
+    double last;                         // Seconds of the last refill;
+    void Refill(double now)
+    {
+        if(now > last) {
+            tokens = std::min(burst, tokens + (now - last) * rate);
+            last = now;
+        }
+    }
+public:
+    TokenBucket(double r, double b, double now)
+        : rate(r), burst(b), tokens(b), last(now) {}
+    // Takes "n" only if there are as many:
+    bool TryTake(double n, double now)
+    {
+        if(rate <= 0.0) { return true; }
+        Refill(now);
+        if(tokens < n) { return false; }
+        tokens -= n;
+        return true;
+    }
+    // Takes "n" anyway, false if the bucket is in debt now:
+    bool Take(double n, double now)
+    {
+        if(rate <= 0.0) { return true; }
+        Refill(now);
+        tokens -= n;
+        return tokens >= 0.0;
+    }
+    // Seconds until "n" tokens are there:
+    double Wait(double n) const
+    {
+        return tokens >= n ? 0.0 : (n - tokens) / rate;
+    }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef UDP_INGEST_AK_H
+#define UDP_INGEST_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     UDP frame ingestion: E1.31 (sACN), Art-Net and DDP.
+     Universes are mapped onto the strip one after another,
+     udp_leds_per_universe LEDs each, starting at LED 0.
+                                                       ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "srv_logger.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+#include "timer.h"
+
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum enum_udp_proto { udp_e131, udp_artnet, udp_ddp };
+
+class UdpIngest;
+
+// timerfd, presents a frame whose sync or push has not come:
+class UdpPresentTimer : public FdHandler {
+private:
+	UdpIngest *master;
+public:
+	UdpPresentTimer(UdpIngest *am, int tfd) 
+		: FdHandler(tfd, true), master(am) {}
+	virtual void Handle(bool r, bool w);
+	void Arm(double sec);
+	void Disarm() { Arm(0.0); }
+	// No copying and assignment:
+	UdpPresentTimer(const UdpPresentTimer&) = delete;
+	UdpPresentTimer& operator=(const UdpPresentTimer&) = delete;
+};
+
+class UdpIngest : public FdHandler {
+friend class UdpPresentTimer;
+private:
+	Selector *sel;
+	SrvLogger *slg;
+	LEDCore *lcp;
+	enum_udp_proto proto;
+	std::vector<uint8_t> buffers;
+	std::vector<mmsghdr> msgs;
+	std::vector<iovec> iovs;
+	bool pending;       // Pixels written, but not presented yet;
+	bool artSynced;     // ArtSync seen recently, wait for it to present;
+	Timer artSyncTimer;
+	uint16_t e131Sync;  // Synchronization universe of the last data packet;
+	bool syncLost;      // A frame timed out, present per wakeup until a sync;
+	UdpPresentTimer presentTimer;
+	UdpIngest(Selector *aFds, LEDCore *cp, SrvLogger *sl,
+	          enum_udp_proto pr, int fdUdp);
+	void Dispatch(const uint8_t *p, size_t len);
+	void DecodeE131(const uint8_t *p, size_t len);
+	void DecodeArtNet(const uint8_t *p, size_t len);
+	void DecodeDdp(const uint8_t *p, size_t len);
+	void WritePixels(size_t offset, const uint8_t *data, size_t len);
+	void Present();
+	void Synced();
+	void SyncTimeout();
+public:
+	// Optional (--udp), so it is made on the heap:
+	static UdpIngest* Start(Selector *sp, LEDCore *cp, SrvLogger *sl,
+	                        enum_udp_proto pr, int port);
+	virtual ~UdpIngest();
+	virtual void Handle(bool r, bool w);
+	// No copying and assignment:
+	UdpIngest(const UdpIngest&) = delete;
+	UdpIngest& operator=(const UdpIngest&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
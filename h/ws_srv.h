@@ -0,0 +1,116 @@
+#ifndef WS_SRV_AK_H
+#define WS_SRV_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     HTTP/WebSocket endpoint for the browser viewers (RFC 6455).
+
+     "GET /" serves the embedded viewer page, "GET /ws" with an upgrade
+     request turns the connection into a viewer. Every presented frame
+     is encoded once into a shared buffer (a binary WebSocket message
+     carrying a frame record of frame_bus.h), the sessions only keep
+     a reference to it and an offset. A viewer that got the previous
+     frame receives the shared delta, others receive the shared keyframe.
+     A viewer whose socket is busy skips frames and gets the newest one.
+                                                                        ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "srv_logger.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+#include "timer.h"
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+class WsServer;
+class FrameBus;
+
+typedef std::shared_ptr<const std::string> WsMessage;
+
+class WsSession : private FdHandler {
+friend class WsServer;
+private:
+	struct Pending {
+		WsMessage msg;
+		size_t done;
+	};
+	std::string inBuf{};
+	std::string networkDetails{};
+	std::deque<Pending> outQ{};       // Not yet accepted by the socket;
+	WsServer *master;
+	bool viewer;                      // Upgraded to WebSocket;
+	bool closing;                     // Halt when the output is flushed;
+	bool halted;
+	uint64_t lastSeq;                 // Last broadcast sent, 0 - none;
+	WsSession(WsServer *am, int fd);
+	virtual ~WsSession() {}
+	virtual void Handle(bool r, bool w);
+	virtual bool WantWrite() const { return !outQ.empty(); }
+	void Halt();
+	void Send(WsMessage msg);
+	void Flush();
+	void ReadRequest();
+	void ReadFrames();
+	void Answer(const char *status, const char *type, std::string_view body);
+	void Upgrade(const std::string &key);
+	void SendCurrent();
+	// No copying and assignment:
+	WsSession(const WsSession&) = delete;
+	WsSession& operator=(const WsSession&) = delete;
+};
+
+class WsServer : public FdHandler, private FrameSubscriber {
+friend class WsSession;
+private:
+	Selector *sel;
+	SrvLogger *slg;
+	FrameBus *bus;
+	std::list<WsSession*> sessions;
+	std::list<WsSession*> garblist;
+	size_t viewers;
+	Timer frameTimer;                 // Decimation to ws_max_fps;
+	double frameDue;
+	// The current broadcast, encoded on demand and shared by the viewers:
+	uint64_t seq;
+	std::vector<CRGB> frame;
+	std::vector<CRGB> prevFrame;
+	uint64_t counter;
+	WsMessage keyMsg;
+	WsMessage deltaMsg;
+	TcpCounters counters;
+	AcceptLoop acceptor;
+	WsServer(Selector *aFds, SrvLogger *sl, FrameBus *fb, int fdSrv);
+	virtual void OnBusFrame(const CRGB *leds, size_t count,
+	                        const FrameInfo &info);
+	WsMessage KeyFrame();
+	WsMessage Delta();
+	void GarbCollect();
+public:
+	static WsServer* Start(Selector *sp, SrvLogger *sl, FrameBus *fb,
+	                       int port);
+	virtual ~WsServer();
+	virtual void Handle(bool r, bool w);
+	void RemoveWsSession(WsSession *s);
+	size_t Viewers() const { return viewers; }
+	// No copying and assignment:
+	WsServer(const WsServer&) = delete;
+	WsServer& operator=(const WsServer&) = delete;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
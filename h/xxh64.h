@@ -0,0 +1,86 @@
+#ifndef XXH64_AK_H
+#define XXH64_AK_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    XXH64 of a buffer, the reference algorithm of xxHash (the same values
+    as XXH64() of the library on a little-endian CPU), several bytes per
+    cycle where FNV-1a does one; hashes the golden frames.
+                                                               ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace le365xxh {
+    inline constexpr uint64_t p1{ 0x9E3779B185EBCA87ull };
+    inline constexpr uint64_t p2{ 0xC2B2AE3D27D4EB4Full };
+    inline constexpr uint64_t p3{ 0x165667B19E3779F9ull };
+    inline constexpr uint64_t p4{ 0x85EBCA77C2B2AE63ull };
+    inline constexpr uint64_t p5{ 0x27D4EB2F165667C5ull };
+
+    inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    inline uint64_t read64(const unsigned char *p)
+        { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    inline uint32_t read32(const unsigned char *p)
+        { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    inline uint64_t round(uint64_t acc, uint64_t in)
+        { return rotl(acc + in * p2, 31) * p1; }
+    inline uint64_t merge(uint64_t acc, uint64_t v)
+        { return (acc ^ round(0, v)) * p1 + p4; }
+}
+
+inline uint64_t xxh64(const void *data, size_t len, uint64_t seed = 0)
+{
+    using namespace le365xxh;
+    const auto *p{ static_cast<const unsigned char*>(data) };
+    const unsigned char *end{ p + len };
+    uint64_t h;
+    if(len >= 32) {
+        uint64_t v1{ seed + p1 + p2 }, v2{ seed + p2 };
+        uint64_t v3{ seed }, v4{ seed - p1 };
+        const unsigned char *limit{ end - 32 };
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while(p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + p5;
+    }
+    h += len;
+    for(; p + 8 <= end; p += 8) {
+        h = rotl(h ^ round(0, read64(p)), 27) * p1 + p4;
+    }
+    if(p + 4 <= end) {
+        h = rotl(h ^ (read32(p) * p1), 23) * p2 + p3;
+        p += 4;
+    }
+    for(; p < end; ++p) {
+        h = rotl(h ^ (uint64_t{ *p } * p5), 11) * p1;
+    }
+    // Avalanche:
+    h ^= h >> 33;
+    h *= p2;
+    h ^= h >> 29;
+    h *= p3;
+    h ^= h >> 32;
+    return h;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    The emulator without its window
+                                   ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "headless_srv.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: HeadlessServer //////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+HeadlessServer::HeadlessServer(int port, int shards, const char *localPath,
+                               bool limits)
+    : logger("/dev/null"), core(), renderSel(&logger), 
+      commands(&renderSel), 
+      network(&core, &logger, &commands, port, shards),
+      loop(&renderSel, nullptr, nullptr, &commands, &network, &core, 
+           nullptr, nullptr),
+      render()
+{
+    if(!limits) { network.SetRateLimits(0.0, 0.0); }
+    if(localPath && *localPath) { network.ListenLocal(localPath); }
+    network.Start();
+    render = std::thread([this]() { loop.Run(); });
+}
+
+HeadlessServer::~HeadlessServer()
+{
+    loop.Stop();
+    render.join();
+    network.Join();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
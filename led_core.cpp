@@ -76,34 +76,97 @@ void LEDCore::NextMode()
     }     
 }   
 
+void CorePultInterface::Execute(const PultCommand &c)
+{
+    if(c.stampNs) { core->CommandArrived(c.source, c.stampNs); }
+    switch(c.cmd) {
+        case pult_mode:     core->SetMode(c.mode);  break;
+        case pult_ok:       core->StopMode();       break;
+        case pult_up:       core->BrightUp();       break;
+        case pult_down:     core->BrightDown();     break;
+        case pult_left:     core->PrevMode();       break;
+        case pult_right:    core->NextMode();       break;
+        case pult_bright:
+            core->SetBright(c.value);
+            if(core->InLive()) {            // No pattern to repaint it;
+                core->Show();
+                core->FltkStep();
+            }
+            break;
+        case pult_frame:
+        case pult_commit:
+            if(c.value >= 0) { core->SetBright(c.value); }
+            std::copy(c.frame.begin(), c.frame.end(), core->GetFstleds());
+            core->CommitLiveFrame();
+            break;
+        default:                                    break;
+    }
+}
 
-void LEDCore::Show()
+
+void LEDCore::Show(const CRGB *src)
 {
+    LE365_PROF_SCOPE(prof, prof_show);
     if(bright == le365const::max_bright) {
-        for(size_t i = 0; i < le365const::num_leds; ++i) {
-            leds.at(i)->color(fl_rgb_color(fstleds[i].GetIntR(),
-                                           fstleds[i].GetIntG(),
-                                           fstleds[i].GetIntB()));
-            leds.at(i)->redraw();
-        }
+        std::copy(src, src + le365const::num_leds, presented.begin());
     } else if(bright < le365const::max_bright && 
               bright > le365const::min_bright) {
         RGBLed led{};
         for(size_t i = 0; i < le365const::num_leds; ++i) {
             double ratio =
                 bright / static_cast<double>(le365const::precision_bright);
-            led.r = ratio * fstleds[i].GetIntR();
-            led.g = ratio * fstleds[i].GetIntG();
-            led.b = ratio * fstleds[i].GetIntB();
-            leds.at(i)->color(fl_rgb_color(led.r, led.g, led.b));
-            leds.at(i)->redraw();
+            led.r = ratio * src[i].r;
+            led.g = ratio * src[i].g;
+            led.b = ratio * src[i].b;
+            presented[i].SetIntRGB(led.r, led.g, led.b);
         }
     } else { // Off, color is black;
-        for(const auto& led : leds) {
-            led->color(FL_BLACK);
-            led->redraw();
+        for(auto& p : presented) { p = CRGB::Black; }
+    }
+    if(leds.front()) { // No widgets when running headless;
+        for(size_t i = 0; i < le365const::num_leds; ++i) {
+            leds.at(i)->color(fl_rgb_color(presented[i].r, 
+                                           presented[i].g, 
+                                           presented[i].b));
+            leds.at(i)->redraw();
         }
     }
+    ++frameCounter;
+    // The photon of the commands since the last frame:
+    uint64_t now{ Timer::NowNs() };
+    shownNs[frameCounter & (le365const::shown_history - 1)] = now;
+    if(prof) {
+        for(size_t i = 0; i < stamps; ++i) {
+            prof->AddCommand(stampSrc[i], now - stampNs[i]);
+        }
+    }
+    stamps = 0;
+    if(!sinks.empty()) {
+        FrameInfo info{ frameCounter, now, currentMode, bright };
+        for(auto s : sinks) { 
+            s->OnFrame(presented.data(), presented.size(), info); 
+        }
+    }
+}
+
+void LEDCore::CommandArrived(pult_source s, uint64_t ns)
+{
+    if(stamps == stampNs.size()) { return; }
+    stampNs[stamps] = ns;
+    stampSrc[stamps] = s;
+    ++stamps;
+}
+
+uint64_t LEDCore::ShownNs(uint64_t frame) const
+{
+    if(frame > frameCounter || 
+       frameCounter - frame >= le365const::shown_history) { return 0; }
+    return shownNs[frame & (le365const::shown_history - 1)];
+}
+
+void LEDCore::RemoveSink(FrameSink *s)
+{
+    std::erase(sinks, s);
 }
 
 void LEDCore::Clear()
@@ -142,6 +205,7 @@ void LEDCore::SetLongWait(double sec)
     wait_for = sec;
     in_waiting = true;
     waitTimer.Reset();
+    virtualWaitStart = virtualSec;
 }
 
 void LEDCore::ClearLongWait()
@@ -152,13 +216,61 @@ void LEDCore::ClearLongWait()
 
 bool LEDCore::NoLongWait()
 {
-    if(waitTimer.Elapsed() >= wait_for) {
+    if(WaitElapsed() >= wait_for) {
         ClearLongWait();
         return true;
     } 
     else { return false; } 
 }
 
+void LEDCore::BeginLiveFrame()
+{
+    in_live = true;
+    liveTimer.Reset();
+}
+
+void LEDCore::CommitLiveFrame()
+{
+    BeginLiveFrame();
+    live_dirty = true;
+}
+
+void LEDCore::ReleaseLive()
+{
+    if(!in_live) { return; }
+    in_live = false;
+    live_dirty = false;
+    // The pattern restores its own state, the empty mode shows black:
+    if(currentMode == mode_null) { Clear(); }
+    ClearLongWait();
+}
+
+void LEDCore::PresentExternal(const CRGB *src)
+{
+    BeginLiveFrame();
+    live_dirty = false;
+    // Kept as the live frame: "bri" re-shows it, the source is reused by
+    // its owner once this returns:
+    std::copy(src, src + le365const::num_leds, fstleds.begin());
+    Show();
+    FltkStep();
+}
+
+bool LEDCore::LiveStep()
+{
+    if(!in_live) { return false; }
+    if(liveTimer.Elapsed() >= le365const::live_timeout_sec) {
+        ReleaseLive();
+        return false;
+    }
+    if(live_dirty) {
+        live_dirty = false;
+        Show();
+        FltkStep();
+    }
+    return true;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 /// SUPPORT FUNCTIONS //////////////////////////////////////////////////////////
@@ -342,8 +454,6 @@ void ModePacifica::PatternStep()
 {   
 	// Increment the four "color index start" counters, one for each wave layer.
 	// Each is incremented at a different speed, and the speeds vary over time.
-	static uint16_t sCIStart1, sCIStart2, sCIStart3, sCIStart4;
-	static uint32_t sLastms = 0;
 	uint32_t ms = core->GetMillis();
 	uint32_t deltams = ms - sLastms;
 	sLastms = ms;
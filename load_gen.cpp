@@ -0,0 +1,675 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Load generator of the control plane: N concurrent connections to the
+    TCP-server (or its Unix socket) replay a weighted mix of the pult
+    commands, m1 .. m9, up, down, left, right and ok. Closed loop keeps
+    "depth" commands in flight per connection, at most the target rate
+    in total; open loop sends on the schedule of the rate whether the
+    replies came or not and counts the latency from the scheduled time,
+    so a stalled server is not hidden (no coordinated omission).
+    Reports the reply latency percentiles, the throughput and the errors.
+
+    Against a running le365r: --port=N (or --unix=path). With --serve[=N]
+    the tool starts a headless server of N shards in the process, the
+    real render loop without the window (see headless_srv.h), with the
+    rate limits off unless --limits; --serve-only just serves, for a load
+    generator on another machine or core set. "make load_bench" runs a
+    fixed matrix of the shard counts and the transports.
+                                                        ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "headless_srv.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+volatile std::sig_atomic_t quit_flag{ 0 };
+
+extern "C" void on_quit(int) { quit_flag = 1; }
+
+struct MixEntry {
+    std::string cmd;            // "m1" .. "ok", without '\n';
+    std::string reply;          // The acknowledgement starts with it;
+    double weight;
+};
+
+struct Options {
+    std::string host{ "127.0.0.1" };
+    int port{ 29300 };
+    std::string unixPath{};
+    int conns{ 16 };
+    int threads{ 1 };
+    double rate{ 0.0 };         // Commands/s in total, 0 - as fast as it goes;
+    bool open{ false };
+    int depth{ 1 };             // In flight per connection, closed loop;
+    double sec{ 5.0 };
+    double timeout{ 2.0 };      // For the replies after the run;
+    uint32_t seed{ 365 };
+    std::vector<MixEntry> mix{};
+    int serve{ 0 };             // Shards of the in-process server, 0 - none;
+    bool serveOnly{ false };
+    bool limits{ false };
+    bool jsonOut{ false };
+    std::string jsonFile{};
+};
+
+// In flight per connection before the open loop skips it:
+constexpr size_t open_max_in_flight{ 1024 };
+
+struct Pending {
+    size_t mix;
+    Clock::time_point t0;
+};
+
+struct Conn {
+    int fd{ -1 };
+    bool ready{ false };        // The greeting came;
+    std::string in{};
+    std::string out{};          // Not yet accepted by the socket;
+    std::deque<Pending> pending{};
+    size_t busyOwed{ 0 };       // "Busy" not yet matched to its command;
+};
+
+struct Stats {
+    uint64_t sent{ 0 };
+    uint64_t ok{ 0 };
+    uint64_t busy{ 0 };         // "Busy, the command is dropped";
+    uint64_t errors{ 0 };       // Other replies, lost with a connection;
+    uint64_t timeouts{ 0 };
+    uint64_t skipped{ 0 };      // Open loop, the connection was too far behind;
+    uint64_t disconnects{ 0 };
+    uint64_t connectFailed{ 0 };
+    std::vector<double> latUs{};
+};
+
+// The acknowledgements of TcpSession::PultDone():
+bool expected_reply(std::string_view cmd, std::string &reply)
+{
+    if(cmd.size() == 2 && cmd[0] == 'm' && cmd[1] >= '1' && cmd[1] <= '9') {
+        reply = std::string("Mode=") + cmd[1];
+        return true;
+    }
+    static const std::pair<std::string_view, const char*> pult[]{
+        { le365const::client_up,    "Up"    },
+        { le365const::client_down,  "Down"  },
+        { le365const::client_left,  "Left"  },
+        { le365const::client_right, "Right" },
+        { le365const::client_ok,    "Ok"    }
+    };
+    for(const auto &p : pult) {
+        if(cmd == p.first) {
+            reply = p.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// "m1:2,up:1,ok" - the commands with their weights, 1 by default:
+bool parse_mix(std::string_view arg, std::vector<MixEntry> &mix)
+{
+    mix.clear();
+    while(!arg.empty()) {
+        size_t comma{ arg.find(',') };
+        std::string_view item{ arg.substr(0, comma) };
+        arg = comma == std::string_view::npos ? std::string_view() :
+                                                arg.substr(comma + 1);
+        size_t colon{ item.find(':') };
+        MixEntry e{ std::string(item.substr(0, colon)), std::string(), 1.0 };
+        if(colon != std::string_view::npos) {
+            e.weight = std::atof(std::string(item.substr(colon + 1)).c_str());
+        }
+        if(!expected_reply(e.cmd, e.reply) || e.weight <= 0.0) {
+            fprintf(stderr, "Bad mix entry: %.*s\n",
+                    static_cast<int>(item.size()), item.data());
+            return false;
+        }
+        mix.push_back(std::move(e));
+    }
+    return !mix.empty();
+}
+
+int connect_to(const Options &o)
+{
+    int s{ -1 };
+    if(!o.unixPath.empty()) {
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, o.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        if(connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+            close(s);
+            return -1;
+        }
+    } else {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *res{ nullptr };
+        std::string port{ std::to_string(o.port) };
+        if(getaddrinfo(o.host.c_str(), port.c_str(), &hints, &res) != 0) {
+            return -1;
+        }
+        s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if(connect(s, res->ai_addr, res->ai_addrlen) == -1) {
+            close(s);
+            s = -1;
+        }
+        freeaddrinfo(res);
+        if(s == -1) { return -1; }
+        int opt{ 1 };
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+    return s;
+}
+
+// Deterministic per thread, the runs replay the same sequence:
+class MixPicker {
+private:
+    const std::vector<MixEntry> &mix;
+    double total;
+    uint64_t state;
+public:
+    MixPicker(const std::vector<MixEntry> &m, uint64_t seed)
+        : mix(m), total(0.0), state(seed * 2862933555777941757ull + 1)
+    {
+        for(const auto &e : mix) { total += e.weight; }
+    }
+    size_t Next()
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        double r{ static_cast<double>(state >> 11) / 9007199254740992.0 *
+                  total };
+        for(size_t i = 0; i < mix.size(); ++i) {
+            if(r < mix[i].weight) { return i; }
+            r -= mix[i].weight;
+        }
+        return mix.size() - 1;
+    }
+};
+
+class Driver {
+private:
+    const Options &opt;
+    std::vector<Conn> conns;
+    double rate;                // This thread's share;
+    MixPicker picker;
+    Stats &st;
+    size_t rr;                  // Round robin over the connections;
+    Conn* Pick(size_t limit);
+    void Send(Conn &c, Clock::time_point t0);
+    void Flush(Conn &c);
+    void Receive(Conn &c);
+    bool Acknowledged(Conn &c, std::string_view line, Clock::time_point now);
+    void Lost(Conn &c);
+    static size_t Unanswered(const Conn &c)
+        { return c.pending.size() - std::min(c.pending.size(), c.busyOwed); }
+    size_t InFlight() const;
+public:
+    Driver(const Options &o, int count, double r, uint64_t seed, Stats &s)
+        : opt(o), conns(static_cast<size_t>(count)), rate(r),
+          picker(o.mix, seed), st(s), rr(0) {}
+    ~Driver() { for(auto &c : conns) { if(c.fd != -1) { close(c.fd); } } }
+    void Run();
+    // No copying and assignment:
+    Driver(const Driver&) = delete;
+    Driver& operator=(const Driver&) = delete;
+};
+
+Conn* Driver::Pick(size_t limit)
+{
+    for(size_t n = 0; n < conns.size(); ++n) {
+        Conn &c{ conns[rr] };
+        rr = (rr + 1) % conns.size();
+        if(c.fd != -1 && c.ready && c.pending.size() < limit) { return &c; }
+    }
+    return nullptr;
+}
+
+void Driver::Send(Conn &c, Clock::time_point t0)
+{
+    size_t m{ picker.Next() };
+    c.out += opt.mix[m].cmd;
+    c.out += '\n';
+    c.pending.push_back(Pending{ m, t0 });
+    ++st.sent;
+    Flush(c);
+}
+
+void Driver::Flush(Conn &c)
+{
+    while(c.fd != -1 && !c.out.empty()) {
+        ssize_t n{ send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL) };
+        if(n > 0) {
+            c.out.erase(0, static_cast<size_t>(n));
+        } else if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else if(n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            Lost(c);
+        }
+    }
+}
+
+void Driver::Receive(Conn &c)
+{
+    char buf[ 4096 ];
+    ssize_t n{ recv(c.fd, buf, sizeof(buf), 0) };
+    if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if(n <= 0) {
+        Lost(c);
+        return;
+    }
+    c.in.append(buf, static_cast<size_t>(n));
+    auto now{ Clock::now() };
+    // Every answer ends with the prompt, the greeting too:
+    const std::string_view prompt{ le365const::server_new_line };
+    size_t end;
+    while((end = c.in.find(prompt)) != std::string::npos) {
+        std::string_view line{ c.in.data(), end };
+        if(line.starts_with("SRV: ")) { line.remove_prefix(5); }
+        if(!c.ready) {
+            c.ready = true;
+        } else if(line == "Keepalive") {
+            // Unsolicited, an idle session;
+        } else if(line.starts_with("Busy")) {
+            ++st.busy;
+            ++c.busyOwed;
+        } else if(!Acknowledged(c, line, now)) {
+            ++st.errors;
+        }
+        c.in.erase(0, end + prompt.size());
+    }
+}
+
+// The acknowledgements come in the order of the commands; "Busy" is
+// answered at once by the network thread, ahead of the acknowledgements
+// still on their way from the render thread, so it is settled by the
+// commands an acknowledgement skips:
+bool Driver::Acknowledged(Conn &c, std::string_view line,
+                          Clock::time_point now)
+{
+    auto it{ std::find_if(c.pending.begin(), c.pending.end(),
+                          [this, line](const Pending &p) {
+        return line.starts_with(opt.mix[p.mix].reply); }) };
+    if(it == c.pending.end()) { return false; }
+    ++st.ok;
+    st.latUs.push_back(std::chrono::duration<double, std::micro>(
+                           now - it->t0).count());
+    auto skipped{ static_cast<size_t>(std::distance(c.pending.begin(), it)) };
+    size_t busy{ std::min(skipped, c.busyOwed) };
+    c.busyOwed -= busy;
+    st.errors += skipped - busy;            // No answer at all;
+    c.pending.erase(c.pending.begin(), std::next(it));
+    return true;
+}
+
+void Driver::Lost(Conn &c)
+{
+    st.errors += Unanswered(c);
+    c.pending.clear();
+    c.busyOwed = 0;
+    ++st.disconnects;
+    close(c.fd);
+    c.fd = -1;
+}
+
+size_t Driver::InFlight() const
+{
+    size_t n{ 0 };
+    for(const auto &c : conns) { n += Unanswered(c); }
+    return n;
+}
+
+void Driver::Run()
+{
+    for(auto &c : conns) {
+        c.fd = connect_to(opt);
+        if(c.fd == -1) { ++st.connectFailed; }
+    }
+    std::vector<pollfd> pfds;
+    std::vector<Conn*> polled;
+    // The schedule starts with all of the greetings in:
+    auto greetUntil{ Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<double>(opt.timeout)) };
+    while(Clock::now() < greetUntil &&
+          std::any_of(conns.begin(), conns.end(), [](const Conn &c) {
+              return c.fd != -1 && !c.ready; })) {
+        pfds.clear();
+        polled.clear();
+        for(auto &c : conns) {
+            if(c.fd == -1 || c.ready) { continue; }
+            pfds.push_back(pollfd{ c.fd, POLLIN, 0 });
+            polled.push_back(&c);
+        }
+        if(poll(pfds.data(), pfds.size(), 10) <= 0) { continue; }
+        for(size_t i = 0; i < pfds.size(); ++i) {
+            if(pfds[i].revents) { Receive(*polled[i]); }
+        }
+    }
+    auto start{ Clock::now() };
+    auto stopAt{ start + std::chrono::duration_cast<Clock::duration>(
+                             std::chrono::duration<double>(opt.sec)) };
+    auto drainUntil{ stopAt + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(opt.timeout)) };
+    double next{ 0.0 };         // The next slot of the schedule, seconds;
+    for(;;) {
+        auto now{ Clock::now() };
+        bool sending{ now < stopAt };
+        if(!sending && (InFlight() == 0 || now >= drainUntil)) { break; }
+        double t{ std::chrono::duration<double>(now - start).count() };
+        while(sending && (rate <= 0.0 || next <= t)) {
+            Conn *c{ Pick(opt.open ? open_max_in_flight :
+                                     static_cast<size_t>(opt.depth)) };
+            if(!c) {
+                // Closed loop waits for a reply, the slot stays due:
+                if(!opt.open) { break; }
+                ++st.skipped;
+            } else {
+                Send(*c, opt.open ?
+                         start + std::chrono::duration_cast<Clock::duration>(
+                                     std::chrono::duration<double>(next)) :
+                         now);
+            }
+            if(rate > 0.0) { next += 1.0 / rate; }
+        }
+        pfds.clear();
+        polled.clear();
+        for(auto &c : conns) {
+            if(c.fd == -1) { continue; }
+            pollfd p{ c.fd, POLLIN, 0 };
+            if(!c.out.empty()) { p.events |= POLLOUT; }
+            pfds.push_back(p);
+            polled.push_back(&c);
+        }
+        if(pfds.empty()) { break; }
+        // Until the next slot, 10 ms at most:
+        double wait{ 0.01 };
+        if(sending && rate > 0.0) { wait = std::clamp(next - t, 0.0, wait); }
+        timespec ts{ 0, static_cast<long>(wait * 1e9) };
+        if(ppoll(pfds.data(), pfds.size(), &ts, nullptr) <= 0) { continue; }
+        for(size_t i = 0; i < pfds.size(); ++i) {
+            if(pfds[i].revents & POLLOUT) { Flush(*polled[i]); }
+            if(polled[i]->fd != -1 &&
+               (pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                Receive(*polled[i]);
+            }
+        }
+    }
+    st.timeouts += InFlight();
+}
+
+double percentile(const std::vector<double> &v, double p)
+{
+    return v.empty() ? 0.0 :
+           v[static_cast<size_t>(p * static_cast<double>(v.size() - 1))];
+}
+
+void write_json(FILE *f, const Options &o, const Stats &st, double wall)
+{
+    double mean{ 0.0 };
+    for(double us : st.latUs) { mean += us; }
+    if(!st.latUs.empty()) { mean /= static_cast<double>(st.latUs.size()); }
+    fprintf(f, "{\n  \"bench\": \"loadgen\",\n  \"version\": 1,\n"
+               "  \"time\": %lld,\n  \"transport\": \"%s\",\n"
+               "  \"serve_shards\": %d,\n  \"conns\": %d,\n"
+               "  \"threads\": %d,\n  \"loop\": \"%s\",\n  \"depth\": %d,\n"
+               "  \"rate\": %g,\n  \"run_sec\": %g,\n  \"wall_sec\": %.3f,\n",
+            static_cast<long long>(time(nullptr)),
+            o.unixPath.empty() ? "tcp" : "unix", o.serve, o.conns, o.threads,
+            o.open ? "open" : "closed", o.depth, o.rate, o.sec, wall);
+    fprintf(f, "  \"sent\": %llu,\n  \"ok\": %llu,\n  \"busy\": %llu,\n"
+               "  \"errors\": %llu,\n  \"timeouts\": %llu,\n"
+               "  \"skipped\": %llu,\n  \"disconnects\": %llu,\n"
+               "  \"connect_failed\": %llu,\n  \"ok_per_sec\": %.1f,\n",
+            static_cast<unsigned long long>(st.sent),
+            static_cast<unsigned long long>(st.ok),
+            static_cast<unsigned long long>(st.busy),
+            static_cast<unsigned long long>(st.errors),
+            static_cast<unsigned long long>(st.timeouts),
+            static_cast<unsigned long long>(st.skipped),
+            static_cast<unsigned long long>(st.disconnects),
+            static_cast<unsigned long long>(st.connectFailed),
+            static_cast<double>(st.ok) / o.sec);
+    fprintf(f, "  \"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, "
+               "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f, "
+               "\"mean\": %.1f}\n}\n",
+            percentile(st.latUs, 0.5), percentile(st.latUs, 0.9),
+            percentile(st.latUs, 0.99), percentile(st.latUs, 0.999),
+            st.latUs.empty() ? 0.0 : st.latUs.back(), mean);
+}
+
+void print_report(const Options &o, const Stats &st)
+{
+    double mean{ 0.0 };
+    for(double us : st.latUs) { mean += us; }
+    if(!st.latUs.empty()) { mean /= static_cast<double>(st.latUs.size()); }
+    printf("%s, %d shard(s), %d conns, %s loop",
+           o.unixPath.empty() ? "tcp" : "unix", o.serve, o.conns,
+           o.open ? "open" : "closed");
+    if(!o.open) { printf(" depth %d", o.depth); }
+    if(o.rate > 0.0) { printf(", %.0f/s", o.rate); }
+    printf(": %9.1f ok/s, p50 %7.1f us, p99 %7.1f us, p99.9 %8.1f us, "
+           "max %8.1f us, mean %7.1f us\n",
+           static_cast<double>(st.ok) / o.sec, percentile(st.latUs, 0.5),
+           percentile(st.latUs, 0.99), percentile(st.latUs, 0.999),
+           st.latUs.empty() ? 0.0 : st.latUs.back(), mean);
+    printf("  sent %llu, ok %llu, busy %llu, errors %llu, timeouts %llu, "
+           "skipped %llu, disconnects %llu, connects failed %llu\n",
+           static_cast<unsigned long long>(st.sent),
+           static_cast<unsigned long long>(st.ok),
+           static_cast<unsigned long long>(st.busy),
+           static_cast<unsigned long long>(st.errors),
+           static_cast<unsigned long long>(st.timeouts),
+           static_cast<unsigned long long>(st.skipped),
+           static_cast<unsigned long long>(st.disconnects),
+           static_cast<unsigned long long>(st.connectFailed));
+}
+
+void print_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options]\n"
+                    "  --host=addr     default: 127.0.0.1\n"
+                    "  --port=N        default: 29300\n"
+                    "  --unix=path     the Unix socket instead of TCP\n"
+                    "  --conns=N       connections (default: 16)\n"
+                    "  --threads=N     client threads (default: 1)\n"
+                    "  --rate=R        commands/s in total, 0 - as fast as "
+                    "it goes (default)\n"
+                    "  --open          open loop, needs --rate\n"
+                    "  --depth=N       in flight per connection, closed loop "
+                    "(default: 1)\n"
+                    "  --duration=sec  default: 5\n"
+                    "  --timeout=sec   for the replies after the run "
+                    "(default: 2)\n"
+                    "  --mix=m1:2,up:1 the commands and weights (default: "
+                    "all alike)\n"
+                    "  --seed=N        of the mix (default: 365)\n"
+                    "  --serve[=N]     a headless server of N shards in the "
+                    "process\n"
+                    "  --serve-only    the server only, until Ctrl-C\n"
+                    "  --limits        the server keeps its rate limits\n"
+                    "  --json          JSON on stdout instead of the report\n"
+                    "  --json=file     the report and JSON into the file\n",
+            prog);
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    Options o{};
+    parse_mix("m1,m2,m3,m4,m5,m6,m7,m8,m9,up,down,left,right,ok", o.mix);
+    for(int i = 1; i < argc; ++i) {
+        std::string_view arg{ argv[i] };
+        bool ok{ true };
+        if(arg.starts_with("--host=")) {
+            o.host = arg.substr(7);
+        } else if(arg.starts_with("--port=")) {
+            o.port = std::atoi(argv[i] + 7);
+            ok = o.port > 0 && o.port < 65536;
+        } else if(arg.starts_with("--unix=")) {
+            o.unixPath = arg.substr(7);
+        } else if(arg.starts_with("--conns=")) {
+            o.conns = std::atoi(argv[i] + 8);
+            ok = o.conns > 0;
+        } else if(arg.starts_with("--threads=")) {
+            o.threads = std::atoi(argv[i] + 10);
+            ok = o.threads > 0;
+        } else if(arg.starts_with("--rate=")) {
+            o.rate = std::atof(argv[i] + 7);
+            ok = o.rate >= 0.0;
+        } else if(arg == "--open") {
+            o.open = true;
+        } else if(arg.starts_with("--depth=")) {
+            o.depth = std::atoi(argv[i] + 8);
+            ok = o.depth > 0;
+        } else if(arg.starts_with("--duration=")) {
+            o.sec = std::atof(argv[i] + 11);
+            ok = o.sec > 0.0;
+        } else if(arg.starts_with("--timeout=")) {
+            o.timeout = std::atof(argv[i] + 10);
+            ok = o.timeout >= 0.0;
+        } else if(arg.starts_with("--mix=")) {
+            ok = parse_mix(arg.substr(6), o.mix);
+        } else if(arg.starts_with("--seed=")) {
+            o.seed = static_cast<uint32_t>(std::strtoul(argv[i] + 7,
+                                                        nullptr, 10));
+        } else if(arg == "--serve") {
+            o.serve = 1;
+        } else if(arg.starts_with("--serve=")) {
+            o.serve = std::atoi(argv[i] + 8);
+            ok = o.serve > 0 && o.serve <= le365const::tcp_max_shards;
+        } else if(arg == "--serve-only") {
+            o.serveOnly = true;
+            o.serve = std::max(o.serve, 1);
+        } else if(arg == "--limits") {
+            o.limits = true;
+        } else if(arg == "--json") {
+            o.jsonOut = true;
+        } else if(arg.starts_with("--json=")) {
+            o.jsonFile = arg.substr(7);
+        } else {
+            ok = false;
+        }
+        if(!ok) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(o.open && o.rate <= 0.0) {
+        fprintf(stderr, "The open loop needs --rate\n");
+        return 1;
+    }
+    o.threads = std::min(o.threads, o.conns);
+
+    std::unique_ptr<HeadlessServer> server{};
+    if(o.serve > 0) {
+        try {
+            server = std::make_unique<HeadlessServer>(
+                         o.port, o.serve, o.unixPath.c_str(), o.limits);
+        } catch(const std::exception &ex) {
+            fprintf(stderr, "Can't start the server: %s\n", ex.what());
+            return 1;
+        }
+    }
+    if(o.serveOnly) {
+        std::signal(SIGINT, on_quit);
+        std::signal(SIGTERM, on_quit);
+        printf("Serving %s %s, %d shard(s), Ctrl-C to stop\n",
+               o.unixPath.empty() ? "port" : "socket",
+               o.unixPath.empty() ? std::to_string(o.port).c_str() :
+                                    o.unixPath.c_str(), o.serve);
+        fflush(stdout);
+        while(!quit_flag) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return 0;
+    }
+
+    // The connections and the rate are split evenly over the threads:
+    std::vector<Stats> stats(static_cast<size_t>(o.threads));
+    std::vector<std::thread> workers;
+    auto t0{ Clock::now() };
+    for(int t = 0; t < o.threads; ++t) {
+        int count{ o.conns / o.threads + (t < o.conns % o.threads ? 1 : 0) };
+        double rate{ o.rate * count / o.conns };
+        workers.emplace_back([&o, &stats, t, count, rate]() {
+            Driver d(o, count, rate, o.seed + static_cast<uint64_t>(t),
+                     stats[static_cast<size_t>(t)]);
+            d.Run();
+        });
+    }
+    for(auto &w : workers) { w.join(); }
+    double wall{ std::chrono::duration<double>(Clock::now() - t0).count() };
+    server.reset();
+
+    Stats all{};
+    for(auto &s : stats) {
+        all.sent += s.sent;
+        all.ok += s.ok;
+        all.busy += s.busy;
+        all.errors += s.errors;
+        all.timeouts += s.timeouts;
+        all.skipped += s.skipped;
+        all.disconnects += s.disconnects;
+        all.connectFailed += s.connectFailed;
+        all.latUs.insert(all.latUs.end(), s.latUs.begin(), s.latUs.end());
+    }
+    std::sort(all.latUs.begin(), all.latUs.end());
+    if(o.jsonOut) {
+        write_json(stdout, o, all, wall);
+    } else {
+        print_report(o, all);
+    }
+    if(!o.jsonFile.empty()) {
+        FILE *f{ fopen(o.jsonFile.c_str(), "w") };
+        if(!f) {
+            perror(o.jsonFile.c_str());
+            return 1;
+        }
+        write_json(f, o, all, wall);
+        fclose(f);
+    }
+    return all.connectFailed == static_cast<uint64_t>(o.conns) ? 1 : 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
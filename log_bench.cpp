@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Benchmark of the log call as the render and network threads see it:
+    latency of WriteLog() with a prepared line, of the deferred Log()
+    and of a record of the binary event log
+                                           ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "srv_logger.h"
+#include "event_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Bursts as of a reconnect storm, the writer catches up in between:
+constexpr int burst{ 100 };
+
+template <typename F>
+void measure(const char *name, int calls, F f)
+{
+    std::vector<double> lat;
+    lat.reserve(static_cast<size_t>(calls));
+    for(int i = 0; i < calls; ++i) {
+        if(i % burst == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        auto t0{ Clock::now() };
+        f(i);
+        lat.push_back(std::chrono::duration<double, std::nano>(
+                          Clock::now() - t0).count());
+    }
+    std::sort(lat.begin(), lat.end());
+    double sum{ 0.0 };
+    for(double ns : lat) { sum += ns; }
+    auto pct{ [&lat](double p) {
+        return lat[static_cast<size_t>(p * static_cast<double>(lat.size() - 1))];
+    } };
+    printf("%-10s: mean %8.0f ns, p50 %8.0f ns, p99 %8.0f ns, max %9.0f ns\n",
+           name, sum / static_cast<double>(lat.size()), pct(0.5), pct(0.99),
+           lat.back());
+}
+
+// Without the two clock reads of measure(), they cost more than a record:
+template <typename F>
+void measure_loop(const char *name, int calls, F f)
+{
+    auto t0{ Clock::now() };
+    for(int i = 0; i < calls; ++i) { f(i); }
+    double ns{ std::chrono::duration<double, std::nano>(
+                   Clock::now() - t0).count() };
+    printf("%-10s: %8.1f ns per call, back to back\n", name, 
+           ns / static_cast<double>(calls));
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    // Usage: le365_log_bench [calls [file]]; the console copy goes to
+    // stderr, redirect it to see the numbers only.
+    int calls{ argc > 1 ? std::max(atoi(argv[1]), 1) : 2000 };
+    const char *file{ argc > 2 ? argv[2] : "/tmp/le365_log_bench.log" };
+    {
+        SrvLogger logger(file);
+        measure("WriteLog", calls, [&logger](int i) {
+            char msg[ 64 ];
+            snprintf(msg, sizeof(msg), "127.0.0.1:%d has connected",
+                     40000 + i % 20000);
+            logger.WriteLog(msg);
+        });
+        measure("Log", calls, [&logger](int i) {
+            logger.Log("%s:%d has disconnected", "127.0.0.1",
+                       40000 + i % 20000);
+        });
+    }
+    EventLog events("/tmp/le365_log_bench.bin", le365evt::default_records);
+    auto put{ [&events](int i) {
+        events.Put(ev_command, static_cast<uint64_t>(i % 256), 0, 0, 0, 
+                   "px 12 ff8000");
+    } };
+    measure("EventLog", calls, put);
+    measure_loop("EventLog", std::max(calls, 1000000), put);
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
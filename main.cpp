@@ -12,13 +12,27 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <memory>
+#include <vector>
 
 #include <X11/Xlib.h>
+#include <signal.h>
 
 #include "common.h"
 #include "led_core.h"
 #include "tcp_srv.h"
+#include "pixel_srv.h"
+#include "udp_ingest.h"
+#include "shm_export.h"
+#include "ring_input.h"
+#include "frame_bus.h"
+#include "pult_queue.h"
+#include "ws_srv.h"
 #include "led_gui.h"
+#include "net_shards.h"
+#include "event_log.h"
+#include "frame_profiler.h"
 #include "main_loop.h"
 #include "process_exception.h"
 
@@ -30,20 +44,183 @@
 CorePultInterface KeyHandler::cpi;
 
 
+////////////////////////////////////////////////////////////////////////////////
+/// COMMAND LINE ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+static void print_usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " <TCP-server port [1024..49151]>" 
+              << " [pixel-stream port [1024..49151]] [options]\n"
+              << "Options:\n"
+              << "  --shm[=name]   publish presented frames to shared memory"
+              << " (default " << le365shm::default_name << ")\n"
+              << "  --ring[=path]  accept frames from a shared-memory ring"
+              << " (default " << le365shm::ring_default_path << ")\n"
+              << "  --pixel[=port] accept binary pixel streams, also enabled by"
+              << " the pixel-stream port (default TCP-server port + "
+              << le365const::pixel_port_shift << ")\n"
+              << "  --udp          accept E1.31, Art-Net and DDP frames on"
+              << " UDP ports " << le365const::udp_e131_port << ", " 
+              << le365const::udp_artnet_port << " and " 
+              << le365const::udp_ddp_port << "\n"
+              << "  --ws[=port]    serve browser viewers over WebSocket"
+              << " (default TCP-server port + " << le365const::ws_port_shift
+              << ")\n"
+              << "  --events[=file] record connects, commands and modes for"
+              << " le365_event_decode (default " << le365evt::default_file 
+              << ")\n"
+              << "  --shards=N     accept on N SO_REUSEPORT listener threads"
+              << " (default 1, at most " << le365const::tcp_max_shards 
+              << ")\n"
+              << "  --idle=SEC     drop a silent client after SEC seconds"
+              << " (default " << le365const::tcp_idle_timeout_sec 
+              << ", 0 - never)\n"
+              << "  --keepalive=SEC prompt a quiet client every SEC seconds"
+              << " (default " << le365const::tcp_keepalive_sec 
+              << ", 0 - off)\n"
+              << "  --stall=SEC    drop a client not reading for SEC seconds"
+              << " (default " << le365const::tcp_write_stall_sec 
+              << ", 0 - never)\n"
+              << "  --cmd-rate=N   commands per second of a client"
+              << " (default " << le365const::tcp_cmd_rate << ", 0 - any)\n"
+              << "  --byte-rate=N  input bytes per second of a client"
+              << " (default " << le365const::tcp_byte_rate << ", 0 - any)\n"
+              << "  --local[=path] serve the commands on a Unix socket too"
+              << " (default " << le365const::tcp_local_default_path << ")\n"
+              << "  --no-tcp       the Unix socket only, needs --local\n" 
+              << "  --perf         hardware counters per stage in \"stats\""
+              << " (PROFILE=1 builds)\n"
+              << "  --trace-dir=DIR write " << le365trace::default_file
+              << " of \"trace stop\" and SIGUSR1 into DIR (default .)"
+              << std::endl;
+}
+
+#ifdef LE365_PROFILE
+// SIGUSR1 starts the trace, the next one writes it (see frame_tracer.h):
+static void on_trace_signal(int)
+{
+    FrameTracer::AskToggle();
+}
+#endif
+
+static bool parse_port(const char *arg, int &port)
+{
+    std::stringstream convert{ arg };
+    return (convert >> port) && port >= 1024 && port <= 49151;
+}
+
+static bool parse_non_negative(const char *arg, double &value)
+{
+    std::stringstream convert{ arg };
+    return (convert >> value) && value >= 0.0;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 /// MAIN BLOCK /////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char *argv[])
 {
-    if(argc <= 1) {
-        std::cerr << "Usage: " << argv[0] << " <TCP-server port [1024..49151]>" 
-                  << std::endl;
+    // Positional arguments are the ports, "--name[=value]" are options:
+    std::vector<const char*> ports;
+    std::string shmName{};
+    std::string ringPath{};
+    bool udp{ false };
+    std::string eventsFile{};
+    const char *wsArg{ nullptr };
+    const char *pixelArg{ nullptr };
+    int shards{ 1 };
+    double idleSec{ le365const::tcp_idle_timeout_sec };
+    double keepaliveSec{ le365const::tcp_keepalive_sec };
+    double stallSec{ le365const::tcp_write_stall_sec };
+    double cmdRate{ le365const::tcp_cmd_rate };
+    double byteRate{ le365const::tcp_byte_rate };
+    std::string localPath{};
+    bool noTcp{ false };
+    bool perf{ false };
+    std::string traceDir{};
+    for(int i = 1; i < argc; ++i) {
+        std::string_view arg{ argv[i] };
+        if(arg == "--shm") { 
+            shmName = le365shm::default_name; 
+        } else if(arg.starts_with("--shm=")) { 
+            shmName = arg.substr(6); 
+        } else if(arg == "--ring") { 
+            ringPath = le365shm::ring_default_path; 
+        } else if(arg.starts_with("--ring=")) { 
+            ringPath = arg.substr(7); 
+        } else if(arg == "--pixel") { 
+            pixelArg = ""; 
+        } else if(arg.starts_with("--pixel=")) { 
+            pixelArg = argv[i] + 8; 
+        } else if(arg == "--udp") { 
+            udp = true;
+        } else if(arg == "--ws") { 
+            wsArg = ""; 
+        } else if(arg.starts_with("--ws=")) { 
+            wsArg = argv[i] + 5; 
+        } else if(arg == "--events") { 
+            eventsFile = le365evt::default_file; 
+        } else if(arg.starts_with("--events=")) { 
+            eventsFile = arg.substr(9); 
+        } else if(arg.starts_with("--shards=")) { 
+            std::stringstream convert{ argv[i] + 9 };
+            if(!(convert >> shards) || shards < 1 || 
+               shards > le365const::tcp_max_shards) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if(arg.starts_with("--idle=") || 
+                  arg.starts_with("--keepalive=") || 
+                  arg.starts_with("--stall=")) {
+            double &sec{ arg[2] == 'i' ? idleSec : 
+                         arg[2] == 'k' ? keepaliveSec : stallSec };
+            if(!parse_non_negative(argv[i] + arg.find('=') + 1, sec)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if(arg.starts_with("--cmd-rate=") || 
+                  arg.starts_with("--byte-rate=")) {
+            double &rate{ arg[2] == 'c' ? cmdRate : byteRate };
+            if(!parse_non_negative(argv[i] + arg.find('=') + 1, rate)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if(arg == "--local") { 
+            localPath = le365const::tcp_local_default_path; 
+        } else if(arg.starts_with("--local=")) { 
+            localPath = arg.substr(8); 
+        } else if(arg == "--no-tcp") { 
+            noTcp = true;
+        } else if(arg == "--perf") { 
+            perf = true;
+        } else if(arg.starts_with("--trace-dir=") && arg.size() > 12) { 
+            traceDir = arg.substr(12);
+        } else if(arg.starts_with("--")) {
+            print_usage(argv[0]);
+            return 1;
+        } else { 
+            ports.push_back(argv[i]); 
+        }
+    }
+    if(ports.empty() || (noTcp && localPath.empty())) {
+        print_usage(argv[0]);
         return 1;
     }
-    std::stringstream convert{ argv[1] };
     int port{};
-    if(!(convert >> port) || (port < 1024 || port > 49151)) { port = 1024; }
+    if(!parse_port(ports[0], port)) { port = 1024; }
+    // The pixel-stream port is off unless asked for:
+    if(ports.size() >= 2 && !pixelArg) { pixelArg = ports[1]; }
+    int pixelPort{};
+    if(pixelArg && !parse_port(pixelArg, pixelPort)) { 
+        pixelPort = port + le365const::pixel_port_shift; 
+    }
+    int wsPort{};
+    if(wsArg && !parse_port(wsArg, wsPort)) { 
+        wsPort = port + le365const::ws_port_shift; 
+    }
     
     std::exception_ptr exceptPtr; // Object for storing exceptions or nullptr.
     
@@ -62,23 +239,134 @@ int main(int argc, char *argv[])
         logMsg += le365const::server_log_file;
         logger.WriteLog(logMsg.c_str());
         
+        // Outlives the threads that record into it; a post-mortem aid,
+        // the emulator runs without it if the file can't be made:
+        std::unique_ptr<EventLog> events{};
+        if(!eventsFile.empty()) {
+            try {
+                events = std::make_unique<EventLog>(eventsFile.c_str(), 
+                                                    le365evt::default_records);
+                std::string evtMsg{ "Events are recorded in: " + eventsFile };
+                logger.WriteLog(evtMsg.c_str());
+            } catch(const std::system_error &ex) {
+                std::string evtMsg{ "Events are not recorded, " + eventsFile + 
+                                    ": " + ex.what() };
+                logger.WriteLog(evtMsg.c_str());
+            }
+        }
+#ifdef LE365_PROFILE
+        FrameProfiler profiler;         // The "stats" and "trace" commands;
+        FrameProfiler *prof{ &profiler };
+        struct sigaction sa{};
+        sa.sa_handler = on_trace_signal;
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &sa, nullptr);
+        if(!traceDir.empty()) { profiler.Tracer().SetDir(traceDir); }
+        std::string traceMsg{ "SIGUSR1 toggles the trace into: " };
+        traceMsg += profiler.Tracer().Path();
+        logger.WriteLog(traceMsg.c_str());
+        // Opened by the render thread, "stats" tells if they are refused:
+        if(perf) { profiler.AskPerf(true); }
+#else
+        FrameProfiler *prof{ nullptr };
+        if(perf) { logger.WriteLog("--perf needs a PROFILE=1 build"); }
+        if(!traceDir.empty()) { 
+            logger.WriteLog("--trace-dir needs a PROFILE=1 build"); 
+        }
+#endif
+        
+        // The render thread serves the display, frame input and the pult 
+        // commands, the network threads serve the clients and viewers:
         Selector selector(&logger);
         LEDCore core;
+        core.SetProfiler(prof);
+        DisplaySession display(&selector, displayFd);
+        PultQueue commands(&selector);
+        auto network{ noTcp ? 
+            std::make_unique<NetShards>(&core, &logger, &commands, 
+                                        localPath.c_str()) :
+            std::make_unique<NetShards>(&core, &logger, &commands, port, 
+                                        shards) };
+        network->SetTimeouts(idleSec, keepaliveSec, stallSec);
+        network->SetRateLimits(cmdRate, byteRate);
+        network->SetEventLog(events.get());
+        network->SetProfiler(prof);
+        if(!noTcp) {
+            std::string srvMsg{ "TCP-server listens port: " + 
+                                 std::to_string(port) + ", threads: " + 
+                                 std::to_string(network->Count()) };    
+            logger.WriteLog(srvMsg.c_str());
+            if(!localPath.empty()) { network->ListenLocal(localPath.c_str()); }
+        }
+        if(!localPath.empty()) {
+            std::string localMsg{ "TCP-server commands on Unix socket: " + 
+                                  localPath };
+            logger.WriteLog(localMsg.c_str());
+        }
+        
+        std::unique_ptr<PixelServer> pixelServer{};
+        if(pixelArg) {
+            pixelServer.reset(PixelServer::Start(&selector, &core, &logger,
+                                                 pixelPort));
+            std::string pixMsg{ "Pixel-stream server listens port: " + 
+                                 std::to_string(pixelPort) };
+            logger.WriteLog(pixMsg.c_str());
+        }
+        
+        std::unique_ptr<UdpIngest> e131{}, artnet{}, ddp{};
+        if(udp) {
+            e131.reset(UdpIngest::Start(&selector, &core, &logger, 
+                           udp_e131, le365const::udp_e131_port));
+            artnet.reset(UdpIngest::Start(&selector, &core, &logger, 
+                             udp_artnet, le365const::udp_artnet_port));
+            ddp.reset(UdpIngest::Start(&selector, &core, &logger, 
+                          udp_ddp, le365const::udp_ddp_port));
+            std::string udpMsg{ "UDP ingestion listens ports: E1.31 " + 
+                    std::to_string(le365const::udp_e131_port) + ", Art-Net " +
+                    std::to_string(le365const::udp_artnet_port) + ", DDP " +
+                    std::to_string(le365const::udp_ddp_port) };
+            logger.WriteLog(udpMsg.c_str());
+        }
+        
+        std::unique_ptr<ShmFramePublisher> shmExport{};
+        if(!shmName.empty()) {
+            shmExport = std::make_unique<ShmFramePublisher>(
+                            shmName.c_str(), le365const::num_leds);
+            core.AddSink(shmExport.get());
+            std::string shmMsg{ "Frames are published to shared memory: " + 
+                                shmName };
+            logger.WriteLog(shmMsg.c_str());
+        }
+        
+        std::unique_ptr<RingInput> ringInput{};
+        if(!ringPath.empty()) {
+            ringInput.reset(RingInput::Start(&selector, &core, &logger, 
+                                             ringPath.c_str()));
+            std::string ringMsg{ "Frame ring producers connect to: " + 
+                                 ringPath };
+            logger.WriteLog(ringMsg.c_str());
+        }
 
-        TcpServer server{ TcpServer::Start(
-                            displayFd, &selector, &core, &logger, port) };
-        std::string srvMsg{ "TCP-server listens port: " + 
-                             std::to_string(port) };    
-        logger.WriteLog(srvMsg.c_str());
+        std::unique_ptr<WsServer> wsServer{};
+        if(wsArg) {
+            wsServer.reset(WsServer::Start(network->MainSelector(), &logger,
+                                           network->MainBus(), wsPort));
+            std::string wsMsg{ "WebSocket viewers: http://<host>:" + 
+                               std::to_string(wsPort) + "/" };
+            logger.WriteLog(wsMsg.c_str());
+        }
 
-        MainLoop loop(&server, &core);
+        network->Start();
+        MainLoop loop(&selector, &display, pixelServer.get(), &commands, 
+                      network.get(), &core, events.get(), prof);
         auto window{ Window365::Make(&core, &loop) };
     
         [[maybe_unused]] auto keyHandler{ new KeyHandler() };
-        KeyHandler::cpi.Init(&core);
+        KeyHandler::cpi.Init(&core, src_key);
     
         window->show();
         loop.Run();
+        network->Join();
         
         logger.WriteLog("Program shutdown with code: 0");
         return 0;
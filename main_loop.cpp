@@ -10,6 +10,11 @@
 
 #include "main_loop.h"
 
+#include <pthread.h>
+
+#include <algorithm>
+#include <cerrno>
+
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -32,12 +37,148 @@ void MainLoop::ModeStep()
     }
 }
 
+void MainLoop::CommandStep()
+{
+    // A budget per frame, state changes of a flood spread over frames
+    // and the pattern keeps its pace; the queue's limit rejects the excess:
+    if(!RepostReplies()) { backlog = true; return; }
+    // Acks held for their frame are bounded too: when they are full the
+    // commands wait for a frame rather than being acknowledged early:
+    auto room{ [this]() {
+        return awaiting.size() < le365const::pult_awaiting_replies; } };
+    PultCommand c{};
+    size_t i{ 0 };
+    for(; i < le365const::pult_commands_per_frame && room() && 
+          commands->Take(c); ++i) {
+        uint64_t frame{ core->GetFrameCounter() };
+        if(c.cmd == pult_trace_start || c.cmd == pult_trace_stop) {
+            Trace(c);
+            continue;
+        }
+        cpi.Execute(c);
+        if(!c.replyTo) { continue; }
+        // A drawn frame is acknowledged once presented, so a query after
+        // the reply reads it back:
+        bool shows{ c.cmd == pult_frame || c.cmd == pult_commit };
+        if(c.timed || shows) {
+            awaiting.push_back(Awaiting{ c, frame });
+        } else {
+            Reply(c);
+        }
+    }
+    backlog = (i == le365const::pult_commands_per_frame || !room());
+}
+
+void MainLoop::EventStep()
+{
+    // Once a frame, whatever has changed the mode (pult, keys, network):
+    if(events) { events->Calibrate(); }
+    if(core->GetMode() == lastMode) { return; }
+    lastMode = core->GetMode();
+    LE365_TRACE_INSTANT(prof, "mode", lastMode);
+    if(!events) { return; }
+    events->Put(ev_mode, 0, 0, static_cast<uint32_t>(lastMode), 
+                static_cast<uint32_t>(core->GetBright()));
+}
+
+void MainLoop::ReplyStep()
+{
+    // Latency to the first frame after the command; no frame comes with
+    // the empty mode, that one is acknowledged unmeasured:
+    if(awaiting.empty()) { return; }
+    bool idle{ core->GetMode() == mode_null && !core->InLive() };
+    uint64_t now{ core->GetFrameCounter() };
+    std::erase_if(awaiting, [this, idle, now](Awaiting &a) {
+        if(now == a.frame && !idle) { return false; }
+        uint64_t shown{ now > a.frame ? core->ShownNs(a.frame + 1) : 0 };
+        a.c.latencyNs = shown > a.c.stampNs ? shown - a.c.stampNs : 0;
+        Reply(a.c);
+        return true;
+    });
+}
+
+void MainLoop::Trace(PultCommand &c)
+{
+    // Here, not on a network thread: the dump stalls the frames it traces
+    // rather than the clients, as with SIGUSR1 (see frame_tracer.h):
+    if(!prof) {
+        c.value = -ENOTSUP;
+    } else if(c.cmd == pult_trace_start) {
+        prof->Tracer().Start();
+    } else {
+        long n{ prof->Tracer().Stop() };
+        c.value = n < 0 ? -errno : static_cast<int>(n);
+    }
+    if(c.replyTo) { Reply(c); }
+}
+
+void MainLoop::Reply(const PultCommand &c)
+{
+    // Never ahead of a refused reply to the same shard, a session gets
+    // its answers in order:
+    bool queued{ std::any_of(unposted.begin(), unposted.end(), 
+                             [&c](const PultCommand &u) 
+                             { return u.replyTo == c.replyTo; }) };
+    if(queued || !c.replyTo->Post(c)) { unposted.push_back(c); }
+}
+
+bool MainLoop::RepostReplies()
+{
+    // A shard still full keeps the rest of its replies; false - too many
+    // are waiting, the commands are not taken this frame:
+    if(unposted.empty()) { return true; }
+    std::vector<PultQueue*> full{};
+    std::erase_if(unposted, [&full](const PultCommand &u) {
+        if(std::find(full.begin(), full.end(), u.replyTo) != full.end()) {
+            return false;
+        }
+        if(u.replyTo->Post(u)) { return true; }
+        full.push_back(u.replyTo);
+        return false;
+    });
+    return unposted.size() < le365const::pult_queue_size;
+}
+
+int MainLoop::WaitUsec() const
+{
+    // Sleep until the pattern's next step, the fds wake us earlier:
+    const int idle{ le365const::select_delay_sec * 1000000 + 
+                    le365const::select_delay_usec };
+    int wait{ idle };
+    if(core->GetMode() != mode_null && !core->InLive()) {
+        wait = std::min(idle, static_cast<int>(core->LongWaitLeft() * 1e6));
+    }
+    // The queue's wakeup has been consumed, the rest go next frame; so
+    // do the replies a full shard has refused:
+    if(backlog || !unposted.empty()) { 
+        wait = std::min(wait, le365const::pult_deferred_usec); 
+    }
+    return wait;
+}
+
 void MainLoop::Run()
 {   
+    pthread_setname_np(pthread_self(), "le365-render");
     core->FltkStep();
-    while(core->CoreRun() && srv->ServerReady()) {
-        srv->ServerStep();
-        ModeStep();
+    while(core->CoreRun() && !(disp && disp->WindowClosed()) && 
+          net->Running() && !stopAsked.load(std::memory_order_relaxed)) {
+        LE365_PROF_POLL(prof);
+        {
+            LE365_PROF_SCOPE(prof, prof_select);
+            sel->Select(WaitUsec());
+        }
+        LE365_PROF_SCOPE(prof, prof_busy);          // To the turn's end;
+        {
+            LE365_PROF_SCOPE(prof, prof_garbage);
+            if(pix) { pix->GarbCollect(); }
+        }
+        {
+            LE365_PROF_SCOPE(prof, prof_commands);
+            CommandStep();
+        }
+        if(!core->LiveStep()) { ModeStep(); }
+        ReplyStep();
+        EventStep();
     }
 }
 
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     IMPLEMENTATION:
+     Network threads of the TCP-server
+                                      ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "net_shards.h"
+
+#include <algorithm>
+#include <exception>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+NetShards::NetShards(LEDCore *cp, SrvLogger *sl, PultQueue *pq, int port,
+                     int count) 
+	: core(cp), shards()
+{
+	count = std::clamp(count, 1, le365const::tcp_max_shards);
+	for(int i = 0; i < count; ++i) {
+		shards.push_back(std::make_unique<Shard>(sl, pq, port, count > 1));
+		core->AddSink(&shards.back()->bus);
+	}
+}
+
+NetShards::NetShards(LEDCore *cp, SrvLogger *sl, PultQueue *pq, 
+                     const char *path) 
+	: core(cp), shards()
+{
+	shards.push_back(std::make_unique<Shard>(sl, pq, path));
+	core->AddSink(&shards.back()->bus);
+}
+
+NetShards::~NetShards()
+{
+	// Threads first, they use the rest of the shards:
+	for(auto &s : shards) { s->thr.reset(); }
+	for(auto &s : shards) { core->RemoveSink(&s->bus); }
+}
+
+void NetShards::SetTimeouts(double idleSec, double keepaliveSec, 
+                            double stallSec)
+{
+	for(auto &s : shards) { 
+		s->srv.SetTimeouts(idleSec, keepaliveSec, stallSec); 
+	}
+}
+
+void NetShards::SetRateLimits(double cmdPerSec, double bytesPerSec)
+{
+	for(auto &s : shards) { s->srv.SetRateLimits(cmdPerSec, bytesPerSec); }
+}
+
+void NetShards::SetEventLog(EventLog *el)
+{
+	for(size_t i = 0; i < shards.size(); ++i) { 
+		shards[i]->srv.SetEventLog(el, static_cast<uint16_t>(i)); 
+	}
+}
+
+void NetShards::SetProfiler(FrameProfiler *fp)
+{
+	for(auto &s : shards) { s->srv.SetProfiler(fp); }
+}
+
+void NetShards::ListenLocal(const char *path)
+{
+	shards.front()->srv.ListenLocal(path);
+}
+
+void NetShards::Start()
+{
+	for(auto &s : shards) {
+		if(!s->thr) { s->thr = std::make_unique<NetworkThread>(&s->srv); }
+	}
+}
+
+bool NetShards::Running() const
+{
+	return std::all_of(shards.begin(), shards.end(), [](const auto &s) {
+		return s->thr && s->thr->Running();
+	});
+}
+
+void NetShards::Join()
+{
+	std::exception_ptr fault{};
+	for(auto &s : shards) {
+		if(!s->thr) { continue; }
+		try {
+			s->thr->Join();
+		} catch(...) {
+			if(!fault) { fault = std::current_exception(); }
+		}
+	}
+	if(fault) { std::rethrow_exception(fault); }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,244 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Headless end-to-end benchmark of the built-in modes: LEDCore and each
+    Pattern without FLTK, stepped as fast as possible on a virtual clock
+    (the waits of a pattern are jumped over). Reports frames per second,
+    ns per LED and the memory of a strip, and the scaling over threads,
+    a strip each, for the modes that keep no shared state.
+
+    The strip is sized at compile time: "make pattern_bench" builds one
+    le365_pattern_bench_N per size of PATTERN_BENCH_LEDS
+                                                        ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "led_core.h"
+#include "timer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+typedef std::unique_ptr<Pattern> (*MakeFn)(LEDCore *core, enum_mode m);
+
+template <typename P>
+std::unique_ptr<Pattern> make_mode(LEDCore *core, enum_mode m)
+{
+    return std::make_unique<P>(core, m);
+}
+
+struct ModeCase {
+    const char *name;
+    enum_mode mode;
+    MakeFn make;
+    size_t bytes;           // sizeof the Pattern;
+    bool parallel;          // No state shared by the instances;
+};
+
+// The glitter and the stars draw from the process-wide prandom_range():
+const ModeCase mode_cases[]{
+    { "rainbow",  mode_1, make_mode<ModeRainbow>,
+      sizeof(ModeRainbow),          true  },
+    { "meteor",   mode_2, make_mode<ModeRainbowMeteor>,
+      sizeof(ModeRainbowMeteor),    true  },
+    { "glitter",  mode_3, make_mode<ModeRainbowGlitter>,
+      sizeof(ModeRainbowGlitter),   false },
+    { "stars",    mode_4, make_mode<ModeStars>,
+      sizeof(ModeStars),            false },
+    { "dots",     mode_5, make_mode<ModeRunningDots>,
+      sizeof(ModeRunningDots),      true  },
+    { "pacifica", mode_6, make_mode<ModePacifica>,
+      sizeof(ModePacifica),         true  },
+    { "rgb",      mode_7, make_mode<ModeRGB>,
+      sizeof(ModeRGB),              true  },
+    { "cmyk",     mode_8, make_mode<ModeCMYK>,
+      sizeof(ModeCMYK),             true  },
+    { "white",    mode_9, make_mode<ModeWhite>,
+      sizeof(ModeWhite),            true  }
+};
+
+struct BenchResult {
+    const char *name;
+    int threads;
+    uint64_t frames;        // All the threads;
+    double sec;
+    double framesPerSec;    // All the threads;
+    double nsPerLed;        // CPU of one thread per LED of a frame;
+    size_t bytes;           // A strip: LEDCore and the Pattern;
+};
+
+// One strip: its own LEDCore and Pattern, stepped until "stop"; the
+// virtual clock moves to the end of each wait, 1 ms at least:
+uint64_t run_strip(const ModeCase &mc, const std::atomic<bool> &stop)
+{
+    auto core{ std::make_unique<LEDCore>() };
+    auto pattern{ mc.make(core.get(), mc.mode) };
+    core->SetMode(mc.mode);
+    double clock{ 0.0 };
+    core->SetVirtualClock(clock);
+    while(!stop.load(std::memory_order_relaxed)) {
+        for(int i = 0; i < 64; ++i) {
+            pattern->Step();
+            clock += std::max(core->LongWaitLeft(), 0.001);
+            core->SetVirtualClock(clock);
+        }
+    }
+    return core->GetFrameCounter();
+}
+
+BenchResult run_mode(const ModeCase &mc, int threads, double sec)
+{
+    std::atomic<bool> stop{ false };
+    std::vector<uint64_t> frames(static_cast<size_t>(threads));
+    std::vector<std::thread> workers;
+    Timer t;
+    for(int i = 1; i < threads; ++i) {
+        workers.emplace_back([&mc, &stop, &frames, i]() {
+            frames[static_cast<size_t>(i)] = run_strip(mc, stop);
+        });
+    }
+    std::thread timer([&stop, sec]() {
+        std::this_thread::sleep_for(std::chrono::duration<double>(sec));
+        stop = true;
+    });
+    frames[0] = run_strip(mc, stop);
+    for(auto &w : workers) { w.join(); }
+    timer.join();
+    double elapsed{ t.Elapsed() };
+    uint64_t total{ 0 };
+    for(uint64_t f : frames) { total += f; }
+    double perSec{ static_cast<double>(total) / elapsed };
+    return BenchResult{ mc.name, threads, total, elapsed, perSec,
+                        perSec > 0.0 ? 1e9 * threads / perSec /
+                                       le365const::num_leds : 0.0,
+                        sizeof(LEDCore) + mc.bytes };
+}
+
+void write_json(FILE *f, const std::vector<BenchResult> &results,
+                double sec)
+{
+    char host[ 64 ]{};
+    gethostname(host, sizeof(host) - 1);
+    fprintf(f, "{\n  \"bench\": \"patterns\",\n  \"version\": 1,\n"
+               "  \"time\": %lld,\n  \"host\": \"%s\",\n"
+               "  \"compiler\": \"%s\",\n  \"leds\": %d,\n"
+               "  \"cpus\": %u,\n  \"run_sec\": %g,\n  \"results\": [\n",
+            static_cast<long long>(time(nullptr)), host, __VERSION__,
+            le365const::num_leds, std::thread::hardware_concurrency(), sec);
+    for(size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r{ results[i] };
+        fprintf(f, "    {\"mode\": \"%s\", \"threads\": %d, "
+                   "\"frames\": %llu, \"frames_per_sec\": %.1f, "
+                   "\"ns_per_led\": %.3f, \"bytes\": %zu}%s\n",
+                r.name, r.threads, static_cast<unsigned long long>(r.frames),
+                r.framesPerSec, r.nsPerLed, r.bytes,
+                i + 1 < results.size() ? "," : "");
+    }
+    fputs("  ]\n}\n", f);
+}
+
+void print_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [--quick] [--filter=mode] [--threads=N] "
+                    "[--json[=file]]\n"
+                    "  --quick       short runs, a smoke run\n"
+                    "  --filter=mode the modes whose name contains it\n"
+                    "  --threads=N   scale up to N threads (default: the "
+                    "CPUs), 1 - off\n"
+                    "  --json        JSON on stdout instead of the table\n"
+                    "  --json=file   the table and JSON into the file\n",
+            prog);
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    double sec{ 1.0 };
+    std::string filter{};
+    int maxThreads{ static_cast<int>(
+                        std::max(1u, std::thread::hardware_concurrency())) };
+    bool jsonOut{ false };
+    std::string jsonFile{};
+    for(int i = 1; i < argc; ++i) {
+        std::string_view arg{ argv[i] };
+        if(arg == "--quick") {
+            sec = 0.1;
+        } else if(arg.starts_with("--filter=")) {
+            filter = arg.substr(9);
+        } else if(arg.starts_with("--threads=")) {
+            maxThreads = std::atoi(argv[i] + 10);
+            if(maxThreads < 1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if(arg == "--json") {
+            jsonOut = true;
+        } else if(arg.starts_with("--json=")) {
+            jsonFile = arg.substr(7);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    if(!jsonOut) {
+        printf("LEDs: %d, sizeof(LEDCore): %zu\n", le365const::num_leds,
+               sizeof(LEDCore));
+        printf("%-10s %7s %12s %10s %10s\n", "mode", "threads", "frames/s",
+               "ns/LED", "bytes");
+    }
+    for(const ModeCase &mc : mode_cases) {
+        if(!filter.empty() &&
+           std::string_view(mc.name).find(filter) == std::string_view::npos) {
+            continue;
+        }
+        // 1, 2, 4 ... and the top, the shared ones on one thread only:
+        for(int th = 1; th <= (mc.parallel ? maxThreads : 1); ) {
+            results.push_back(run_mode(mc, th, sec));
+            if(!jsonOut) {
+                const BenchResult &r{ results.back() };
+                printf("%-10s %7d %12.1f %10.3f %10zu\n", r.name, r.threads,
+                       r.framesPerSec, r.nsPerLed, r.bytes);
+                fflush(stdout);
+            }
+            if(th == maxThreads) { break; }
+            th = std::min(th * 2, maxThreads);
+        }
+    }
+    if(jsonOut) { write_json(stdout, results, sec); }
+    if(!jsonFile.empty()) {
+        FILE *f{ fopen(jsonFile.c_str(), "w") };
+        if(!f) {
+            perror(jsonFile.c_str());
+            return 1;
+        }
+        write_json(f, results, sec);
+        fclose(f);
+    }
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
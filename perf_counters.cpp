@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Hardware counters of a thread, perf_event_open(2)
+                                                     ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: PerfCounters ////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+static int perf_open(uint32_t type, uint64_t config, int group)
+{
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group == -1 ? 1 : 0;        // The leader starts them;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // This thread, any CPU:
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group,
+                                    PERF_FLAG_FD_CLOEXEC));
+}
+
+int PerfCounters::Open()
+{
+    Close();
+    static constexpr uint64_t l1d_read_miss{
+        PERF_COUNT_HW_CACHE_L1D |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) };
+    const struct { uint32_t type; uint64_t config; } events[ perf_counters ]{
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, l1d_read_miss }
+    };
+    int err{ 0 };
+    int leader{ -1 };
+    for(size_t i = 0; i < perf_counters; ++i) {
+        int fd{ perf_open(events[i].type, events[i].config, leader) };
+        if(fd == -1) {
+            // The first refusal tells why, it is the same for the rest:
+            if(!err) { err = errno; }
+            continue;
+        }
+        if(leader == -1) { leader = fd; }
+        fds[i] = fd;
+        slots[i] = opened++;
+    }
+    if(leader == -1) { return err ? err : ENOENT; }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0;
+}
+
+void PerfCounters::Close()
+{
+    for(int &fd : fds) {
+        if(fd != -1) { close(fd); }
+        fd = -1;
+    }
+    opened = 0;
+}
+
+bool PerfCounters::Read(PerfSample &s) const
+{
+    if(!opened) { return false; }
+    // PERF_FORMAT_GROUP: the number of the counters, then their values:
+    uint64_t buf[ 1 + perf_counters ];
+    size_t leader{ 0 };
+    while(fds[leader] == -1) { ++leader; }
+    ssize_t n{ read(fds[leader], buf, sizeof(buf)) };
+    if(n < static_cast<ssize_t>(sizeof(uint64_t) * (1 + opened)) ||
+       buf[0] != opened) {
+        return false;
+    }
+    for(size_t i = 0; i < perf_counters; ++i) {
+        s.v[i] = fds[i] != -1 ? buf[1 + slots[i]] : 0;
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
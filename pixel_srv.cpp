@@ -0,0 +1,209 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     IMPLEMENTATION:
+     Binary pixel-stream server
+                                ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "pixel_srv.h"
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <new>
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+PixelServer* PixelServer::Start(Selector *sel, LEDCore *cp,
+                                SrvLogger *slg, int port)
+{
+	// Non-blocking: Handle() accepts until the queue is empty.
+	int ls{ socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0) };
+	if(ls == -1) [[unlikely]] {
+		slg->WriteLog("TcpServerFault(PixelServer::Start() in: socket())");
+	    throw TcpServerFault("PixelServer::Start() in: socket()");
+	}
+	int opt { 1 };
+	setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(static_cast<uint16_t>(port));
+	int res{ bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) };
+	if(res == -1) [[unlikely]] {
+	    slg->WriteLog("TcpServerFault(PixelServer::Start() in: bind())");
+	    throw TcpServerFault("PixelServer::Start() in: bind()");
+	}
+	res = listen(ls, le365const::tcp_qlen_for_listen);
+	if(res == -1) [[unlikely]] {
+	    slg->WriteLog("TcpServerFault(PixelServer::Start() in: listen())");
+	    throw TcpServerFault("PixelServer::Start() in: listen()");
+	}
+	return new PixelServer(sel, cp, slg, ls);
+}
+
+PixelServer::PixelServer(Selector *asl, LEDCore *cp, SrvLogger *alg, int fdSrv)
+	: FdHandler(fdSrv, true), sel(asl), slg(alg), lcp(cp), garblist(),
+	  counters(), acceptor(alg, "Pixel-stream server", &counters)
+{
+	asl->Add(this);
+}
+
+PixelServer::~PixelServer()
+{
+	sel->Remove(this);
+	GarbCollect();
+}
+
+void PixelServer::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	sockaddr_storage addr{};
+	for(int sd; (sd = acceptor.Next(GetFd(), addr)) != -1; addr = {}) {
+		if(!AcceptLoop::Watchable(sd)) [[unlikely]] {
+			acceptor.Drop(sd, "descriptor beyond FD_SETSIZE");
+			continue;
+		}
+		// Frames are drained until EAGAIN, see PixelSession::Handle():
+		PixelSession *p{ nullptr };
+		try {
+			p = new PixelSession(this, sd, lcp);
+		} catch(const std::bad_alloc&) {
+			acceptor.Drop(sd, "out of memory");
+			continue;
+		}
+		acceptor.Accepted();
+		sel->Add(p);
+		auto &in{ reinterpret_cast<const sockaddr_in&>(addr) };
+		p->networkDetails = inet_ntoa(in.sin_addr);
+		p->networkDetails += ":";
+		p->networkDetails += std::to_string(ntohs(in.sin_port));
+		std::string logMsg{ p->networkDetails + 
+		                    " has connected (pixel stream)" };
+		slg->WriteLog(logMsg.c_str());
+	}
+}
+
+void PixelServer::RemovePixelSession(PixelSession *s)
+{
+	std::string logMsg{ s->networkDetails +
+	                    " has disconnected (pixel stream)" };
+	sel->Remove(s);
+	// The peer may be gone already, the descriptor is closed by ~FdHandler:
+	shutdown(s->GetFd(), SHUT_RDWR);
+	garblist.push_back(s);
+	slg->WriteLog(logMsg.c_str());
+}
+
+void PixelServer::GarbCollect()
+{
+    auto iter = garblist.begin();
+    while(iter != garblist.end()) {
+		delete *iter; // Delete session object.
+        iter = garblist.erase(iter); // Erase std::list item and go to next.
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+PixelSession::PixelSession(PixelServer *am, int fd, LEDCore *cp)
+	: FdHandler(fd, true), header(), discard(), hdrUsed(0),
+	  channel(0), command(0), payloadLen(0), payloadDone(0),
+	  master(am), core(cp) {}
+
+void PixelSession::Halt()
+{
+	master->RemovePixelSession(this);
+}
+
+void PixelSession::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	for(int i = 0; i < le365const::pixel_reads_per_wakeup; ++i) {
+		uint8_t *dst{ nullptr };
+		size_t len{ 0 };
+		bool inHeader{ hdrUsed < le365const::pixel_header_size };
+		if(inHeader) {
+			dst = header + hdrUsed;
+			len = static_cast<size_t>(le365const::pixel_header_size - hdrUsed);
+		} else {
+			ReadPayload(dst, len);
+		}
+		ssize_t n{ read(GetFd(), dst, len) };
+		if(n == 0) { Halt(); return; }
+		if(n < 0) {
+			if(errno == EINTR) { continue; }
+			if(errno != EAGAIN && errno != EWOULDBLOCK) { Halt(); }
+			return;
+		}
+		if(inHeader) {
+			hdrUsed += static_cast<int>(n);
+			if(hdrUsed < le365const::pixel_header_size) { continue; }
+			if(!ParseHeader()) {
+				master->slg->Log("%s sent a bad header (pixel stream)",
+				                 networkDetails.c_str());
+				Halt();
+				return;
+			}
+			if(payloadLen == 0 && FinishMessage()) { return; }
+		} else {
+			payloadDone += static_cast<uint32_t>(n);
+			if(payloadDone == payloadLen && FinishMessage()) { return; }
+		}
+	}
+}
+
+bool PixelSession::ParseHeader()
+{
+	// Not zero - not this protocol, or a stream out of step with it:
+	if(header[2] != 0 || header[3] != 0) { return false; }
+	channel = header[0];
+	command = header[1];
+	payloadLen = (uint32_t{ header[4] } << 24) | (uint32_t{ header[5] } << 16) |
+	             (uint32_t{ header[6] } << 8)  |  uint32_t{ header[7] };
+	payloadDone = 0;
+	// Keep the pattern off the framebuffer while the payload is arriving:
+	if(command == pixel_set && channel <= 1) { core->BeginLiveFrame(); }
+	return true;
+}
+
+void PixelSession::ReadPayload(uint8_t *&dst, size_t &len)
+{
+	size_t left{ payloadLen - payloadDone };
+	size_t fbSize{ core->GetLiveBufferSize() };
+	bool toStrip{ command == pixel_set && channel <= 1 };
+	if(toStrip && payloadDone < fbSize) {
+		// Zero-copy: the socket is read right into the framebuffer.
+		dst = core->GetLiveBuffer() + payloadDone;
+		len = std::min(left, fbSize - payloadDone);
+	} else {
+		// LEDs beyond the strip and foreign channels are dropped:
+		dst = discard;
+		len = std::min(left, sizeof(discard));
+	}
+}
+
+bool PixelSession::FinishMessage()
+{
+	bool committed{ channel <= 1 && command == pixel_set };
+	if(channel <= 1) {
+		switch(command) {
+			case pixel_set:         core->CommitLiveFrame();   break;
+			case pixel_release:     core->ReleaseLive();       break;
+			default:                                           break;
+		}
+	}
+	hdrUsed = 0;
+	payloadLen = 0;
+	payloadDone = 0;
+	return committed;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
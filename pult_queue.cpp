@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     IMPLEMENTATION:
+     Hand-over of the pult commands between the threads
+                                                       ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "pult_queue.h"
+
+#include <sys/eventfd.h>
+
+#include <system_error>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+static int make_pult_eventfd()
+{
+	int fd{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) };
+	if(fd == -1) [[unlikely]] {
+		throw std::system_error(errno, std::generic_category(),
+		                        "PultQueue in: eventfd()");
+	}
+	return fd;
+}
+
+PultQueue::PultQueue(Selector *sp, std::function<void()> wake)
+	: FdHandler(make_pult_eventfd(), true), sel(sp), queue(), rung(false),
+	  onWake(std::move(wake))
+{
+	sel->Add(this);
+}
+
+PultQueue::~PultQueue()
+{
+	sel->Remove(this);
+}
+
+bool PultQueue::Post(const PultCommand &c)
+{
+	if(!queue.TryPush(c)) { return false; }
+	if(!rung.exchange(true, std::memory_order_acq_rel)) {
+		uint64_t one{ 1 };
+		[[maybe_unused]] ssize_t n{ write(GetFd(), &one, sizeof(one)) };
+	}
+	return true;
+}
+
+void PultQueue::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	uint64_t rings{};
+	[[maybe_unused]] ssize_t n{ read(GetFd(), &rings, sizeof(rings)) };
+	// Posts from now on ring again, the consumer drains after this:
+	rung.exchange(false, std::memory_order_acq_rel);
+	if(onWake) { onWake(); }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
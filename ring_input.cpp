@@ -0,0 +1,229 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Emulator side of the shared-memory frame ring
+                                                 ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ring_input.h"
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <new>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+RingInput* RingInput::Start(Selector *sel, LEDCore *cp, SrvLogger *slg,
+                            const char *path)
+{
+	int ls{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+	if(ls == -1) [[unlikely]] {
+		slg->WriteLog("TcpServerFault(RingInput::Start() in: socket())");
+	    throw TcpServerFault("RingInput::Start() in: socket()");
+	}
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if(!unlink_stale_socket(path)) {
+		close(ls);
+		slg->Log("TcpServerFault(RingInput::Start(): %s is in use or not "
+		         "a socket)", path);
+	    throw TcpServerFault("RingInput::Start() in: unlink()");
+	}
+	// A producer gets the doorbell and writes the frames, owner only:
+	mode_t mask{ umask(S_IRWXG | S_IRWXO) };
+	int res{ bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) };
+	umask(mask);
+	if(res == -1) [[unlikely]] {
+		close(ls);
+	    slg->WriteLog("TcpServerFault(RingInput::Start() in: bind())");
+	    throw TcpServerFault("RingInput::Start() in: bind()");
+	}
+	res = listen(ls, 1);
+	if(res == -1) [[unlikely]] {
+		close(ls);
+		unlink(path);
+	    slg->WriteLog("TcpServerFault(RingInput::Start() in: listen())");
+	    throw TcpServerFault("RingInput::Start() in: listen()");
+	}
+	return new RingInput(sel, cp, slg, path, ls);
+}
+
+RingInput::RingInput(Selector *asl, LEDCore *cp, SrvLogger *alg,
+                     const char *aPath, int fdSrv)
+	: FdHandler(fdSrv, true), sel(asl), slg(alg), lcp(cp), path(aPath),
+	  shmName(le365shm::ring_shm_prefix), link(nullptr), bell(nullptr),
+	  hdr(nullptr), slots(nullptr), mapSize(0), slotCount(0), slotSize(0),
+	  garblist()
+{
+	shmName += std::to_string(getpid());
+	asl->Add(this);
+}
+
+RingInput::~RingInput()
+{
+	if(link) { Detach(); }
+	GarbCollect();
+	sel->Remove(this);
+	unlink(path.c_str());
+}
+
+void RingInput::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	GarbCollect();
+	int sd{ accept4(GetFd(), nullptr, nullptr, SOCK_CLOEXEC) };
+	if(sd == -1) [[unlikely]] { return; }
+	if(link) {
+		slg->WriteLog("Frame ring: producer rejected, the ring is busy");
+		close(sd);
+		return;
+	}
+	if(!Attach(sd)) {
+		slg->WriteLog("Frame ring: producer handshake failed");
+		close(sd);
+		return;
+	}
+	slg->WriteLog("Frame ring: producer has connected");
+}
+
+bool RingInput::Attach(int sd)
+{
+	const uint32_t numLeds{ le365const::num_leds };
+	const uint32_t count{ le365shm::ring_slots };
+	size_t size{ shm_ring_segment_size(numLeds, count) };
+	int fd{ shm_open(shmName.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600) };
+	if(fd == -1) { return false; }
+	if(ftruncate(fd, static_cast<off_t>(size)) == -1) {
+		close(fd);
+		shm_unlink(shmName.c_str());
+		return false;
+	}
+	void *p{ mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+	close(fd);
+	if(p == MAP_FAILED) {
+		shm_unlink(shmName.c_str());
+		return false;
+	}
+	int efd{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) };
+	if(efd == -1) {
+		munmap(p, size);
+		shm_unlink(shmName.c_str());
+		return false;
+	}
+	auto *h{ new(p) ShmRingHeader{} };
+	h->magic = le365shm::ring_magic;
+	h->version = le365shm::ring_version;
+	h->headerSize = sizeof(ShmRingHeader);
+	h->numLeds = numLeds;
+	h->slotCount = count;
+	h->slotSize = numLeds * 3;
+	// The segment name as a line, the doorbell as SCM_RIGHTS:
+	std::string line{ shmName + "\n" };
+	char ctrl[ CMSG_SPACE(sizeof(int)) ]{};
+	iovec iov{ line.data(), line.size() };
+	msghdr msg{};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctrl;
+	msg.msg_controllen = sizeof(ctrl);
+	cmsghdr *cm{ CMSG_FIRSTHDR(&msg) };
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cm), &efd, sizeof(int));
+	if(sendmsg(sd, &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(line.size())) {
+		close(efd);
+		munmap(p, size);
+		shm_unlink(shmName.c_str());
+		return false;
+	}
+	hdr = h;
+	slots = static_cast<uint8_t*>(p) + sizeof(ShmRingHeader);
+	mapSize = size;
+	slotCount = count;
+	slotSize = h->slotSize;
+	link = new RingLink(this, sd);
+	bell = new RingDoorbell(this, efd);
+	sel->Add(link);
+	sel->Add(bell);
+	return true;
+}
+
+void RingInput::Detach()
+{
+	if(!link) { return; }
+	sel->Remove(link);
+	sel->Remove(bell);
+	// Deleted on the next accept, so the descriptors aren't reused 
+	// while the Selector is still walking its ready set:
+	garblist.push_back(link);
+	garblist.push_back(bell);
+	link = nullptr;
+	bell = nullptr;
+	munmap(hdr, mapSize);
+	shm_unlink(shmName.c_str());
+	hdr = nullptr;
+	slots = nullptr;
+	mapSize = 0;
+	slotCount = 0;
+	slotSize = 0;
+	lcp->ReleaseLive();
+	slg->WriteLog("Frame ring: producer has gone, back to the pattern");
+}
+
+void RingInput::Doorbell()
+{
+	uint64_t rings{};
+	[[maybe_unused]] ssize_t n{ read(bell->GetFd(), &rings, sizeof(rings)) };
+	uint64_t h{ hdr->head.load(std::memory_order_acquire) };
+	uint64_t t{ hdr->tail.load(std::memory_order_relaxed) };
+	if(h == t) { return; }
+	// The indices come from the producer, a broken one is dropped:
+	if(t > h || h - t > slotCount) [[unlikely]] {
+		slg->WriteLog("Frame ring: bad head or tail, producer dropped");
+		Detach();
+		return;
+	}
+	// Only the newest frame is shown, the older ones are skipped:
+	const uint8_t *slot{ slots + ((h - 1) % slotCount) * slotSize };
+	lcp->PresentExternal(reinterpret_cast<const CRGB*>(slot));
+	hdr->tail.store(h, std::memory_order_release);
+}
+
+void RingInput::GarbCollect()
+{
+    auto iter = garblist.begin();
+    while(iter != garblist.end()) {
+		delete *iter; // Delete handler object.
+        iter = garblist.erase(iter); // Erase std::list item and go to next.
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+void RingDoorbell::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	master->Doorbell();
+}
+
+void RingLink::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	char buf[64];
+	ssize_t n{ read(GetFd(), buf, sizeof(buf)) };
+	if(n <= 0) { master->Detach(); } // Producer has gone;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
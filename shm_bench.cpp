@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/*** 
+    Benchmark of the shared-memory framebuffer export:
+    publishing cost on the render loop and the reader latency 
+                                                             ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "shm_export.h"
+#include "shm_frame.h"
+#include "timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+uint64_t now_ns()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + 
+           static_cast<uint64_t>(ts.tv_nsec);
+}
+
+double publish_ns(ShmFramePublisher &pub, const std::vector<CRGB> &frame,
+                  int iterations)
+{
+    FrameInfo info{ 0, 0, mode_1, le365const::max_bright };
+    Timer t;
+    for(int i = 0; i < iterations; ++i) {
+        info.counter = static_cast<uint64_t>(i);
+        info.timestampNs = now_ns();
+        pub.OnFrame(frame.data(), frame.size(), info);
+    }
+    return t.Elapsed() * 1e9 / iterations;
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    const char *name{ "/le365_shm_bench" };
+    uint32_t numLeds{ le365const::num_leds };
+    if(argc > 1) { numLeds = static_cast<uint32_t>(std::atoi(argv[1])); }
+    const int iterations{ 200000 };
+    const int liveFrames{ 2000 };
+    
+    std::vector<CRGB> frame(numLeds, CRGB(CRGB::Gold));
+    ShmFramePublisher pub(name, numLeds);
+    ShmFrameReader rd;
+    if(!rd.Open(name)) {
+        fprintf(stderr, "Can't open %s\n", name);
+        return 1;
+    }
+    
+    // Cost on the render loop, nobody reading:
+    double publish{ publish_ns(pub, frame, iterations) };
+    
+    // Cost of one consistent copy on the reader side:
+    ShmFrame f;
+    Timer t;
+    for(int i = 0; i < iterations; ++i) { rd.Read(f); }
+    double read{ t.Elapsed() * 1e9 / iterations };
+    
+    // Live: the writer presents frames at ~1 kHz, the reader polls:
+    std::atomic<bool> stop{ false };
+    uint64_t seen{ 0 }, lagSum{ 0 }, lagMax{ 0 };
+    std::thread reader([&]() {
+        ShmFrame lf;
+        uint64_t last{ rd.LastFrame() };
+        while(!stop.load(std::memory_order_relaxed)) {
+            if(rd.LastFrame() == last) { std::this_thread::yield(); continue; }
+            if(!rd.Read(lf)) { continue; }
+            uint64_t lag{ now_ns() - lf.timestampNs };
+            last = rd.LastFrame();
+            lagSum += lag;
+            if(lag > lagMax) { lagMax = lag; }
+            ++seen;
+        }
+    });
+    for(int i = 0; i < liveFrames; ++i) {
+        publish_ns(pub, frame, 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop = true;
+    reader.join();
+    
+    printf("LEDs: %u\n", numLeds);
+    printf("publish (render loop):   %10.1f ns/frame\n", publish);
+    printf("read, consistent copy:   %10.1f ns/frame\n", read);
+    printf("live: %d frames presented, %llu seen by the reader\n", liveFrames,
+           static_cast<unsigned long long>(seen));
+    printf("live: present-to-read lag %10.1f ns mean, %llu ns max\n",
+           seen ? static_cast<double>(lagSum) / static_cast<double>(seen) 
+                : 0.0,
+           static_cast<unsigned long long>(lagMax));
+    return 0;
+}
+
+
+////////////////
@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Publishing of every presented frame 
+    into a POSIX shared-memory segment
+                                      ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "shm_export.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <system_error>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+ShmFramePublisher::ShmFramePublisher(const char *shmName, uint32_t numLeds)
+    : name(shmName), hdr(nullptr), pixels(nullptr), 
+      mapSize(shm_frame_segment_size(numLeds))
+{
+    int fd{ shm_open(shmName, O_CREAT | O_RDWR, 0644) };
+    if(fd == -1) [[unlikely]] {
+        throw std::system_error(errno, std::generic_category(), 
+                                "ShmFramePublisher in: shm_open()");
+    }
+    if(ftruncate(fd, static_cast<off_t>(mapSize)) == -1) [[unlikely]] {
+        int err{ errno };
+        close(fd);
+        throw std::system_error(err, std::generic_category(), 
+                                "ShmFramePublisher in: ftruncate()");
+    }
+    void *p{ mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, 
+                  MAP_SHARED, fd, 0) };
+    close(fd);
+    if(p == MAP_FAILED) [[unlikely]] {
+        throw std::system_error(errno, std::generic_category(), 
+                                "ShmFramePublisher in: mmap()");
+    }
+    memset(p, 0, mapSize);
+    hdr = new(p) ShmFrameHeader{};
+    hdr->magic = le365shm::magic;
+    hdr->version = le365shm::version;
+    hdr->headerSize = sizeof(ShmFrameHeader);
+    hdr->numLeds = numLeds;
+    hdr->mode = mode_null;
+    pixels = static_cast<uint8_t*>(p) + sizeof(ShmFrameHeader);
+}
+
+ShmFramePublisher::~ShmFramePublisher()
+{
+    munmap(hdr, mapSize);
+    shm_unlink(name.c_str());
+}
+
+void ShmFramePublisher::OnFrame(const CRGB *leds, size_t count, 
+                                const FrameInfo &info)
+{
+    size_t bytes{ std::min(count, size_t{ hdr->numLeds }) * sizeof(CRGB) };
+    uint64_t s{ hdr->seq.load(std::memory_order_relaxed) };
+    hdr->seq.store(s + 1, std::memory_order_relaxed);   // Odd: busy;
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->frameCounter = info.counter;
+    hdr->timestampNs = info.timestampNs;
+    hdr->mode = info.mode;
+    hdr->bright = info.bright;
+    memcpy(pixels, leds, bytes);
+    hdr->seq.store(s + 2, std::memory_order_release);   // Even: ready.
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
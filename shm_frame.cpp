@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Reader library for the shared-memory framebuffer segment
+                                                            ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "shm_frame.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t shm_frame_segment_size(uint32_t numLeds)
+{
+    return sizeof(ShmFrameHeader) + size_t{ numLeds } * 3;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ShmFrameReader::Open(const char *name)
+{
+    Close();
+    int fd{ shm_open(name, O_RDONLY, 0) };
+    if(fd == -1) { return false; }
+    struct stat st{};
+    if(fstat(fd, &st) == -1 ||
+       static_cast<size_t>(st.st_size) < sizeof(ShmFrameHeader)) {
+        close(fd);
+        return false;
+    }
+    void *p{ mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                  MAP_SHARED, fd, 0) };
+    close(fd);
+    if(p == MAP_FAILED) { return false; }
+    auto h{ static_cast<const ShmFrameHeader*>(p) };
+    // The geometry comes from the segment, it is read once and must fit
+    // the mapping; the publisher may rewrite the header afterwards:
+    uint32_t leds{ h->numLeds };
+    size_t headerSize{ h->headerSize };
+    if(h->magic != le365shm::magic || h->version != le365shm::version ||
+       headerSize < sizeof(ShmFrameHeader) ||
+       headerSize + size_t{ leds } * 3 > static_cast<size_t>(st.st_size)) {
+        munmap(p, static_cast<size_t>(st.st_size));
+        return false;
+    }
+    hdr = h;
+    pixels = static_cast<const uint8_t*>(p) + headerSize;
+    mapSize = static_cast<size_t>(st.st_size);
+    numLeds = leds;
+    return true;
+}
+
+void ShmFrameReader::Close()
+{
+    if(hdr) { munmap(const_cast<ShmFrameHeader*>(hdr), mapSize); }
+    hdr = nullptr;
+    pixels = nullptr;
+    mapSize = 0;
+    numLeds = 0;
+}
+
+uint64_t ShmFrameReader::LastFrame() const
+{
+    if(!hdr) { return 0; }
+    // Even seq / 2 is the number of published frames:
+    return hdr->seq.load(std::memory_order_acquire) / 2;
+}
+
+uint64_t ShmFrameReader::BeginRead() const
+{
+    // No wait here: a publisher that died mid-write leaves seq odd for good:
+    return hdr->seq.load(std::memory_order_acquire);
+}
+
+bool ShmFrameReader::EndRead(uint64_t seq) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return !(seq & 1) && hdr->seq.load(std::memory_order_relaxed) == seq;
+}
+
+bool ShmFrameReader::Read(ShmFrame &out, int maxRetries) const
+{
+    if(!hdr) { return false; }
+    size_t bytes{ size_t{ numLeds } * 3 };
+    out.rgb.resize(bytes);
+    // A write in progress costs a retry as a torn copy does:
+    for(int i = 0; i < maxRetries; ++i) {
+        uint64_t s{ BeginRead() };
+        if(s & 1) { continue; }
+        out.frameCounter = hdr->frameCounter;
+        out.timestampNs = hdr->timestampNs;
+        out.mode = hdr->mode;
+        out.bright = hdr->bright;
+        memcpy(out.rgb.data(), pixels, bytes);
+        if(EndRead(s)) { return true; }
+    }
+    return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Producer side of the shared-memory frame ring
+                                                 ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "shm_ring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t shm_ring_segment_size(uint32_t numLeds, uint32_t slots)
+{
+    return sizeof(ShmRingHeader) + size_t{ numLeds } * 3 * slots;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ShmRingProducer::Connect(const char *path)
+{
+    Close();
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock == -1) { return false; }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if(connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        Close();
+        return false;
+    }
+    // One line with the segment name, the eventfd rides along:
+    char name[ le365shm::ring_name_max + 1 ]{};
+    char ctrl[ CMSG_SPACE(sizeof(int)) ]{};
+    iovec iov{ name, le365shm::ring_name_max };
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    ssize_t n{ recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) };
+    cmsghdr *cm{ CMSG_FIRSTHDR(&msg) };
+    if(n <= 0 || !cm || cm->cmsg_type != SCM_RIGHTS) {
+        Close();
+        return false;
+    }
+    memcpy(&bell, CMSG_DATA(cm), sizeof(int));
+    name[n] = 0;
+    if(char *nl{ strchr(name, '\n') }; nl) { *nl = 0; }
+
+    int fd{ shm_open(name, O_RDWR, 0) };
+    if(fd == -1) {
+        Close();
+        return false;
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    void *p{ mmap(nullptr, static_cast<size_t>(st.st_size),
+                  PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+    close(fd);
+    if(p == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    hdr = static_cast<ShmRingHeader*>(p);
+    mapSize = static_cast<size_t>(st.st_size);
+    if(hdr->magic != le365shm::ring_magic ||
+       hdr->version != le365shm::ring_version) {
+        Close();
+        return false;
+    }
+    slots = static_cast<uint8_t*>(p) + hdr->headerSize;
+    return true;
+}
+
+void ShmRingProducer::Close()
+{
+    if(hdr) { munmap(hdr, mapSize); }
+    if(bell != -1) { close(bell); }
+    if(sock != -1) { close(sock); }
+    sock = -1;
+    bell = -1;
+    hdr = nullptr;
+    slots = nullptr;
+    mapSize = 0;
+}
+
+uint8_t* ShmRingProducer::AcquireSlot()
+{
+    if(!hdr) { return nullptr; }
+    uint64_t h{ hdr->head.load(std::memory_order_relaxed) };
+    uint64_t t{ hdr->tail.load(std::memory_order_acquire) };
+    if(h - t >= hdr->slotCount) { return nullptr; }
+    return slots + (h % hdr->slotCount) * hdr->slotSize;
+}
+
+void ShmRingProducer::Publish()
+{
+    if(!hdr) { return; }
+    hdr->head.fetch_add(1, std::memory_order_release);
+    uint64_t one{ 1 };
+    [[maybe_unused]] ssize_t n{ write(bell, &one, sizeof(one)) };
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
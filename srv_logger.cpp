@@ -10,29 +10,224 @@
 
 #include "srv_logger.h"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <ctime>
 
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// One conversion of "fmt" at "spec" (just after '%') with the captured
+// argument; the length modifiers of the caller are replaced by the kind:
+const char* format_one(const char *spec, const LogRecord &r, size_t &arg,
+                       std::string &out)
+{
+    const char *p{ spec };
+    while(*p && strchr("-+ #0", *p)) { ++p; }
+    while(*p && (isdigit(static_cast<unsigned char>(*p)) || *p == '.' ||
+                 *p == '*')) { ++p; }
+    const char *flagsEnd{ p };
+    while(*p && strchr("hlLqjzt", *p)) { ++p; }
+    char conv{ *p };
+    if(!conv) {
+        out += '%';
+        out.append(spec);
+        return p;
+    }
+    if(conv == '%') {
+        out += '%';
+        return p + 1;
+    }
+    if(arg >= r.count || memchr(spec, '*', static_cast<size_t>(p - spec))) {
+        out += '%';                     // Nothing to print, as written;
+        out.append(spec, static_cast<size_t>(p + 1 - spec));
+        return p + 1;
+    }
+    std::string f{ "%" };
+    f.append(spec, static_cast<size_t>(flagsEnd - spec));
+    uint64_t bits{ r.args[arg] };
+    LogRecord::arg_kind kind{ r.kinds[arg] };
+    ++arg;
+    char buf[ 128 ];
+    int n{ 0 };
+    double d{};
+    std::memcpy(&d, &bits, sizeof(d));
+    auto asInt{ [kind, bits, d]() {
+        return kind == LogRecord::arg_double ? static_cast<long long>(d) :
+                                               static_cast<long long>(bits);
+    } };
+    if(kind == LogRecord::arg_str) {
+        const char *s{ r.text.data() + bits };
+        if(f.size() == 1) {
+            out.append(s);                  // Plain "%s", no copy;
+            return p + 1;
+        }
+        n = snprintf(buf, sizeof(buf), (f + 's').c_str(), s);
+    } else if(strchr("di", conv)) {
+        n = snprintf(buf, sizeof(buf), (f + "lld").c_str(), asInt());
+    } else if(strchr("ouxX", conv)) {
+        n = snprintf(buf, sizeof(buf), (f + "ll" + conv).c_str(),
+                     static_cast<unsigned long long>(asInt()));
+    } else if(strchr("eEfFgGaA", conv)) {
+        double v{ kind == LogRecord::arg_double ? d :
+                  kind == LogRecord::arg_int ?
+                      static_cast<double>(static_cast<int64_t>(bits)) :
+                      static_cast<double>(bits) };
+        n = snprintf(buf, sizeof(buf), (f + conv).c_str(), v);
+    } else if(conv == 'c') {
+        n = snprintf(buf, sizeof(buf), (f + 'c').c_str(),
+                     static_cast<int>(asInt()));
+    } else {                                    // A number for "%s", "%p":
+        n = kind == LogRecord::arg_double ?
+            snprintf(buf, sizeof(buf), "%g", d) :
+            kind == LogRecord::arg_int ?
+            snprintf(buf, sizeof(buf), "%lld", asInt()) :
+            snprintf(buf, sizeof(buf), "%llu",
+                     static_cast<unsigned long long>(bits));
+    }
+    if(n > 0) {
+        out.append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
+    }
+    return p + 1;
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// CLASS: SrvLogger ///////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-SrvLogger::SrvLogger(const char *file_name) : lg()
+SrvLogger::SrvLogger(const char *file_name, log_overflow p)
+    : queue(std::make_unique<MpscQueue<LogRecord, queue_size>>()),
+      file(std::fopen(file_name, "w")), policy(p), posted(0), dropped(0),
+      stop(false), writer()
+{
+    writer = std::thread(&SrvLogger::Run, this);
+}
+
+SrvLogger::~SrvLogger()
+{
+    stop.store(true, std::memory_order_release);
+    posted.fetch_add(1, std::memory_order_release);
+    posted.notify_one();
+    writer.join();
+    if(file) { std::fclose(file); }
+}
+
+int64_t SrvLogger::NowUsec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void SrvLogger::AddText(LogRecord &r, const char *s)
+{
+    if(!s) { s = "(null)"; }
+    size_t room{ r.text.size() - r.used };
+    if(room == 0) { return; }
+    size_t len{ std::min(strlen(s), room - 1) };    // Cut, with the zero;
+    std::memcpy(r.text.data() + r.used, s, len);
+    r.text[r.used + len] = 0;
+    r.used = static_cast<uint16_t>(r.used + len + 1);
+}
+
+bool SrvLogger::Push(const LogRecord &r)
 {
-    logging::formatter formatter = expr::stream
-        << expr::format_date_time<bptm::ptime>("TimeStamp", 
-                                               "%d-%m-%Y / %H:%M:%S:%f") 
-        << " -> " << expr::message;
-    logging::add_file_log(file_name, 
-        logging::keywords::auto_flush = true)->set_formatter(formatter);
-    logging::add_console_log(std::clog)->set_formatter(formatter);
-    logging::add_common_attributes();
+    while(!queue->TryPush(r)) {
+        if(policy == log_drop) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        posted.fetch_add(1, std::memory_order_release);
+        posted.notify_one();
+        std::this_thread::yield();
+    }
+    posted.fetch_add(1, std::memory_order_release);
+    posted.notify_one();
+    return true;
 }
 
 bool SrvLogger::WriteLog(const char *msg)
 {
-    logging::record rec = lg.open_record();
-    if(rec) {
-        logging::record_ostream strm(rec);
-        strm << msg;
-        strm.flush();
-        lg.push_record(boost::move(rec));
-        return true;
-    }  else { return false; }
-}
\ No newline at end of file
+    LogRecord r{};
+    r.usec = NowUsec();
+    AddText(r, msg);
+    return Push(r);
+}
+
+void log_stamp(int64_t usec, std::string &out)
+{
+    time_t sec{ static_cast<time_t>(usec / 1000000) };
+    tm t{};
+    localtime_r(&sec, &t);
+    char stamp[ 48 ];
+    size_t n{ strftime(stamp, sizeof(stamp), "%d-%m-%Y / %H:%M:%S", &t) };
+    snprintf(stamp + n, sizeof(stamp) - n, ":%06lld -> ",
+             static_cast<long long>(usec % 1000000));
+    out.append(stamp);
+}
+
+void SrvLogger::Format(const LogRecord &r, std::string &out)
+{
+    log_stamp(r.usec, out);
+    if(!r.fmt) {
+        out.append(r.text.data());
+    } else {
+        size_t arg{ 0 };
+        for(const char *p = r.fmt; *p;) {
+            const char *pc{ strchr(p, '%') };
+            if(!pc) {
+                out.append(p);
+                break;
+            }
+            out.append(p, static_cast<size_t>(pc - p));
+            p = format_one(pc + 1, r, arg, out);
+        }
+    }
+    out += '\n';
+}
+
+void SrvLogger::Run()
+{
+    // A batch is written and flushed at once, a burst costs one syscall:
+    static constexpr size_t batch_max{ 64 * 1024 };
+    std::string batch{};
+    batch.reserve(batch_max + 1024);
+    uint64_t reported{ 0 };
+    LogRecord r{};
+    for(;;) {
+        uint32_t seen{ posted.load(std::memory_order_acquire) };
+        batch.clear();
+        while(batch.size() < batch_max && queue->TryPop(r)) {
+            Format(r, batch);
+        }
+        uint64_t lost{ dropped.load(std::memory_order_relaxed) };
+        if(lost != reported) {
+            LogRecord note{};
+            note.usec = NowUsec();
+            std::string msg{ "Logger: " + std::to_string(lost - reported) +
+                             " records dropped, the queue was full" };
+            AddText(note, msg.c_str());
+            Format(note, batch);
+            reported = lost;
+        }
+        if(!batch.empty()) {
+            if(file) {
+                std::fwrite(batch.data(), 1, batch.size(), file);
+                std::fflush(file);
+            }
+            std::fwrite(batch.data(), 1, batch.size(), stderr);
+            continue;
+        }
+        if(stop.load(std::memory_order_acquire)) { break; }
+        posted.wait(seen, std::memory_order_acquire);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
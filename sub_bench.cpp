@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/*** 
+    Benchmark of the frame subscription stream:
+    bandwidth and server CPU per subscriber (headless, loopback)
+                                                                ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "frame_bus.h"
+#include "led_core.h"
+#include "tcp_srv.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+double thread_cpu_sec()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + ts.tv_nsec * 1e-9;
+}
+
+int connect_client(int port)
+{
+    int s{ socket(AF_INET, SOCK_STREAM, 0) };
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if(connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(s);
+        return -1;
+    }
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+    return s;
+}
+
+size_t drain(int s)
+{
+    char buf[65536];
+    size_t total{ 0 };
+    ssize_t n{};
+    while((n = read(s, buf, sizeof(buf))) > 0) { 
+        total += static_cast<size_t>(n); 
+    }
+    return total;
+}
+
+// Full: every LED changes each frame; sparse: a single LED moves.
+void render(LEDCore &core, bool full, int frame)
+{
+    if(full) {
+        fill_rainbow(core.GetFstleds(), le365const::num_leds, 
+                     static_cast<uint8_t>(frame), 5);
+    } else {
+        fill_solid(core.GetFstleds(), le365const::num_leds, CRGB::Black);
+        core[frame % le365const::num_leds] = CRGB::White;
+    }
+    core.Show();
+}
+
+void run(SrvLogger &logger, int subscribers, bool full, int port)
+{
+    const int frames{ 600 };
+    Selector selector(&logger);
+    LEDCore core;
+    FrameBus bus(&selector);
+    core.AddSink(&bus);
+    TcpServer server{ TcpServer::Start(&selector, &logger, &bus, 
+                                       nullptr, port) };
+    std::vector<int> clients;
+    for(int i = 0; i < subscribers; ++i) {
+        int c{ connect_client(port) };
+        if(c == -1) { break; }
+        server.ServerStep();            // Accept;
+        clients.push_back(c);
+    }
+    const char sub[]{ "subscribe 0\n" };
+    for(int c : clients) { 
+        [[maybe_unused]] ssize_t n{ write(c, sub, sizeof(sub) - 1) };
+    }
+    for(int i = 0; i < 4; ++i) { server.ServerStep(); }
+    for(int c : clients) { drain(c); }
+    
+    size_t bytes{ 0 };
+    double cpu{ 0.0 };
+    for(int f = 0; f < frames; ++f) {
+        double t0{ thread_cpu_sec() };
+        render(core, full, f);
+        server.ServerStep();
+        cpu += thread_cpu_sec() - t0;
+        for(int c : clients) { bytes += drain(c); }
+    }
+    double perSub{ static_cast<double>(bytes) / 
+                   static_cast<double>(clients.size()) / frames };
+    printf("%4zu subscribers, %-6s frames: %7.1f B/frame/sub "
+           "(%7.1f KiB/s at 60 FPS), server CPU %6.2f us/frame/sub\n",
+           clients.size(), full ? "full" : "sparse", perSub, 
+           perSub * 60 / 1024, cpu * 1e6 / frames / static_cast<double>(clients.size()));
+    for(int c : clients) { close(c); }
+    for(int i = 0; i < 4; ++i) { server.ServerStep(); }
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+    // Connects are logged to std::clog, the results go to std::cout:
+    SrvLogger logger("/dev/null");
+    int port{ 41000 };
+    for(int subs : { 10, 100 }) {
+        run(logger, subs, true, port++);
+        run(logger, subs, false, port++);
+    }
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
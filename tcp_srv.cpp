@@ -9,6 +9,159 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "tcp_srv.h"
+#include "frame_bus.h"
+#include "pult_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// DRAWING COMMANDS ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// The parsers move "p" past the argument:
+static bool ParseInt(const char *&p, int lo, int hi, int &v)
+{
+	char *end{ nullptr };
+	long l{ strtol(p, &end, 10) };
+	if(end == p || l < lo || l > hi) { return false; }
+	v = static_cast<int>(l);
+	p = end;
+	return true;
+}
+
+static bool ParseIndex(const char *&p, int &i)
+{
+	return ParseInt(p, 0, le365const::num_leds - 1, i);
+}
+
+// "RRGGBB" or "#RRGGBB":
+static bool ParseColor(const char *&p, CRGB &c)
+{
+	while(*p == ' ') { ++p; }
+	if(*p == '#') { ++p; }
+	uint32_t v{ 0 };
+	for(int k = 0; k < 6; ++k) {
+		auto ch{ static_cast<unsigned char>(p[k]) };
+		if(!isxdigit(ch)) { return false; }
+		v = v << 4 | static_cast<uint32_t>(isdigit(ch) ? ch - '0' : 
+		                                   tolower(ch) - 'a' + 10);
+	}
+	if(p[6] != ' ' && p[6] != 0) { return false; }
+	c = CRGB(v);
+	p += 6;
+	return true;
+}
+
+static bool AtEnd(const char *p)
+{
+	while(*p == ' ') { ++p; }
+	return *p == 0;
+}
+
+// Step "k" of "n" from "a" to "b":
+static CRGB Lerp(const CRGB &a, const CRGB &b, int k, int n)
+{
+	auto ch{ [k, n](uint8_t x, uint8_t y) { 
+		return static_cast<uint8_t>(x + (y - x) * k / n); 
+	} };
+	return n ? CRGB(ch(a.r, b.r), ch(a.g, b.g), ch(a.b, b.b)) : a;
+}
+
+static bool DrawPixel(CRGB *leds, const char *args)
+{
+	int i{};
+	CRGB c{};
+	if(!ParseIndex(args, i) || !ParseColor(args, c) || !AtEnd(args)) {
+		return false;
+	}
+	leds[i] = c;
+	return true;
+}
+
+static bool DrawRange(CRGB *leds, const char *args)
+{
+	int from{}, to{};
+	CRGB c{};
+	if(!ParseIndex(args, from) || !ParseIndex(args, to) || 
+	   !ParseColor(args, c) || !AtEnd(args)) { return false; }
+	if(from > to) { std::swap(from, to); }
+	std::fill(leds + from, leds + to + 1, c);
+	return true;
+}
+
+static bool DrawFill(CRGB *leds, const char *args)
+{
+	CRGB c{};
+	if(!ParseColor(args, c) || !AtEnd(args)) { return false; }
+	fill_solid(leds, le365const::num_leds, c);
+	return true;
+}
+
+static bool DrawGradient(CRGB *leds, const char *args)
+{
+	int from{}, to{};
+	CRGB c1{}, c2{};
+	if(!ParseIndex(args, from) || !ParseIndex(args, to) || 
+	   !ParseColor(args, c1) || !ParseColor(args, c2) || !AtEnd(args)) { 
+		return false; 
+	}
+	// From "c1" at "from" to "c2" at "to", either way round:
+	int n{ std::abs(to - from) };
+	int dir{ to >= from ? 1 : -1 };
+	for(int k = 0; k <= n; ++k) { leds[from + dir * k] = Lerp(c1, c2, k, n); }
+	return true;
+}
+
+static bool DrawPalette(CRGB *leds, const char *args)
+{
+	int from{}, to{};
+	if(!ParseIndex(args, from) || !ParseIndex(args, to)) { return false; }
+	std::array<CRGB, 16> stops{};
+	int n{ 0 };
+	while(n < 16 && !AtEnd(args)) {
+		if(!ParseColor(args, stops[static_cast<size_t>(n)])) { return false; }
+		++n;
+	}
+	if(n < 2 || !AtEnd(args)) { return false; }
+	// The stops spread evenly over the 16 entries, blended in between:
+	CRGBPalette16 pal{};
+	for(int j = 0; j < 16; ++j) {
+		int pos{ j * (n - 1) * 256 / 15 };                  // 8.8 fixed;
+		auto s{ static_cast<size_t>(pos >> 8) };
+		pal[j] = s + 1 < static_cast<size_t>(n) ? 
+		         Lerp(stops[s], stops[s + 1], pos & 0xff, 256) : stops[s];
+	}
+	int span{ std::abs(to - from) };
+	int dir{ to >= from ? 1 : -1 };
+	for(int k = 0; k <= span; ++k) {
+		// 240 is the last entry, 255 would blend back into the first one:
+		auto index{ static_cast<uint8_t>(span ? k * 240 / span : 0) };
+		leds[from + dir * k] = ColorFromPalette(pal, index, 255, LINEARBLEND);
+	}
+	return true;
+}
+
+// A batch costs one command: its drawing lines only paint the canvas and
+// the commit posts it; any other line is charged as outside a batch:
+static bool FreeInBatch(std::string_view line)
+{
+	std::string_view cmd{ line.substr(0, line.find(' ')) };
+	if(!cmd.empty() && cmd.back() == '\r') { cmd.remove_suffix(1); }
+	return cmd == le365const::client_px || cmd == le365const::client_range ||
+	       cmd == le365const::client_fill || 
+	       cmd == le365const::client_grad || 
+	       cmd == le365const::client_pal || 
+	       cmd == le365const::client_commit;
+}
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -44,7 +197,7 @@ bool Selector::Remove(FdHandler *fdh)
 	return true;
 }
 
-void Selector::Select()
+void Selector::Select(int waitUsec)
 {
 	int i{};
 	fd_set rds;
@@ -52,8 +205,8 @@ void Selector::Select()
 	FD_ZERO(&rds);
     FD_ZERO(&wrs);
 	timeval to;
-    to.tv_sec   = le365const::select_delay_sec;
-    to.tv_usec  = le365const::select_delay_usec;
+    to.tv_sec   = waitUsec / 1000000;
+    to.tv_usec  = waitUsec % 1000000;
 	for(i = 0; i <= maxFd; ++i) {
 		if(fdArray[i]) {
 			if(fdArray[i]->WantRead()) { FD_SET(i, &rds); }
@@ -80,16 +233,118 @@ void Selector::Select()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-TcpServer TcpServer::Start(int display, Selector *sel, LEDCore *cp,
-                           SrvLogger *slg, int port)
+AcceptLoop::AcceptLoop(SrvLogger *sl, const char *aName, TcpCounters *tc)
+	: slg(sl), name(aName), counters(tc), 
+	  reserveFd(open("/dev/null", O_RDONLY | O_CLOEXEC)), shedding(false),
+	  onShed()
+{}
+
+AcceptLoop::~AcceptLoop()
+{
+	if(reserveFd != -1) { close(reserveFd); }
+}
+
+int AcceptLoop::Next(int ls, sockaddr_storage &addr)
+{
+	for(;;) {
+		socklen_t len{ sizeof(addr) };
+		// Replies are buffered, see TcpSession::Send():
+		int sd{ accept4(ls, reinterpret_cast<sockaddr*>(&addr), &len,
+		                SOCK_NONBLOCK | SOCK_CLOEXEC) };
+		if(sd != -1) [[likely]] { return sd; }
+		switch(errno) {
+		case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+		case EWOULDBLOCK:
+#endif
+			return -1;                               // Queue is empty;
+		case EINTR:
+			continue;
+		case EMFILE:
+		case ENFILE:
+			if(Shed(ls)) { continue; }
+			return -1;                               // Retried on wakeup;
+		case ENOBUFS:
+		case ENOMEM:
+			StartShedding("out of memory");
+			return -1;                               // Retried on wakeup;
+		case EBADF:
+		case EFAULT:
+		case EINVAL:
+		case ENOTSOCK:
+		case EOPNOTSUPP:
+			slg->Log("TcpServerFault(%s in: accept())", name);
+			throw TcpServerFault("AcceptLoop::Next() in: accept()"); 
+		default:
+			// ECONNABORTED, EPROTO and network errors: that peer only.
+			counters->reset.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+	}
+}
+
+void AcceptLoop::StartShedding(const char *why)
+{
+	if(shedding) { return; }
+	shedding = true;
+	slg->Log("%s sheds connections: %s", name, why);
+	if(onShed) { onShed(why); }
+}
+
+bool AcceptLoop::Shed(int ls)
+{
+	StartShedding("no file descriptors");
+	// The reserve descriptor makes room to accept and close at once,
+	// otherwise the peer would hang in the listen queue:
+	if(reserveFd == -1) { return false; }
+	close(reserveFd);
+	int sd{ accept4(ls, nullptr, nullptr, SOCK_CLOEXEC) };
+	if(sd != -1) {
+		close(sd);
+		counters->shed.fetch_add(1, std::memory_order_relaxed);
+	}
+	reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	return sd != -1;
+}
+
+void AcceptLoop::Drop(int sd, const char *why)
+{
+	close(sd);
+	counters->shed.fetch_add(1, std::memory_order_relaxed);
+	StartShedding(why);
+}
+
+bool AcceptLoop::Accepted()
+{
+	counters->accepted.fetch_add(1, std::memory_order_relaxed);
+	if(!shedding) { return false; }
+	shedding = false;
+	slg->Log("%s accepts again, shed in total: %llu", name,
+	         static_cast<unsigned long long>(counters->shed.load()));
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+TcpServer TcpServer::Start(Selector *sel, SrvLogger *slg, FrameBus *fb, 
+                           PultQueue *pq, int port, bool reusePort)
 {
-	int ls{ socket(AF_INET, SOCK_STREAM, 0) };
+	// Non-blocking: Handle() accepts until the queue is empty.
+	int ls{ socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0) };
 	if(ls == -1) [[unlikely]] {
 		slg->WriteLog("TcpServerFault(Start() in: socket())");
 	    throw TcpServerFault("Start() in: socket()");
 	}
 	int opt { 1 };
 	setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	// Sharded listeners, the kernel spreads the connections among them:
+	if(reusePort && 
+	   setsockopt(ls, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+		close(ls);
+		slg->WriteLog("TcpServerFault(Start() in: SO_REUSEPORT)");
+	    throw TcpServerFault("Start() in: SO_REUSEPORT");
+	}
 	sockaddr_in addr{};
 	addr.sin_family = AF_INET;
 	addr.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -104,81 +359,308 @@ TcpServer TcpServer::Start(int display, Selector *sel, LEDCore *cp,
 	    slg->WriteLog("TcpServerFault(Start() in: listen())");
 	    throw TcpServerFault("Start() in: listen()");
 	}
-	return TcpServer(display, sel, cp, slg, ls);
+	return TcpServer(sel, slg, fb, pq, ls);
+}
+
+bool unlink_stale_socket(const char *path)
+{
+	struct stat st{};
+	if(lstat(path, &st) == -1) { return errno == ENOENT; }
+	if(!S_ISSOCK(st.st_mode)) { return false; }
+	// Nobody listens on a stale one, a running instance answers:
+	int s{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+	if(s == -1) { return false; }
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	bool stale{ connect(s, reinterpret_cast<sockaddr*>(&addr), 
+	                    sizeof(addr)) == -1 && errno == ECONNREFUSED };
+	close(s);
+	return stale && (unlink(path) == 0 || errno == ENOENT);
+}
+
+int TcpServer::LocalSocket(SrvLogger *slg, const char *path)
+{
+	int ls{ socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0) };
+	if(ls == -1) [[unlikely]] {
+		slg->WriteLog("TcpServerFault(LocalSocket() in: socket())");
+	    throw TcpServerFault("LocalSocket() in: socket()");
+	}
+	if(!unlink_stale_socket(path)) {
+		close(ls);
+		slg->Log("TcpServerFault(LocalSocket(): %s is in use or not a "
+		         "socket)", path);
+	    throw TcpServerFault("LocalSocket() in: unlink()");
+	}
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	// The control surface is for the owner only, from the start:
+	mode_t mask{ umask(S_IRWXG | S_IRWXO) };
+	int res{ bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) };
+	umask(mask);
+	if(res == -1) [[unlikely]] {
+		close(ls);
+	    slg->WriteLog("TcpServerFault(LocalSocket() in: bind())");
+	    throw TcpServerFault("LocalSocket() in: bind()");
+	}
+	res = listen(ls, le365const::tcp_qlen_for_listen);
+	if(res == -1) [[unlikely]] {
+		close(ls);
+		unlink(path);
+	    slg->WriteLog("TcpServerFault(LocalSocket() in: listen())");
+	    throw TcpServerFault("LocalSocket() in: listen()");
+	}
+	return ls;
+}
+
+TcpServer TcpServer::StartLocal(Selector *sel, SrvLogger *slg, FrameBus *fb, 
+                                PultQueue *pq, const char *path)
+{
+	return TcpServer(sel, slg, fb, pq, LocalSocket(slg, path), path);
+}
+
+void TcpServer::ListenLocal(const char *path)
+{
+	int ls{ LocalSocket(slg, path) };
+	local = std::make_unique<LocalListener>(sel, this, ls, path);
 }
 
-TcpServer::TcpServer(int fdDisp, Selector *asl, 
-                     LEDCore *cp, SrvLogger *alg, int fdSrv) 
-	                      : FdHandler(fdSrv, true), disp(fdDisp), 
-	                        sel(asl), slg(alg), lcp(cp),
-	                        garblist(), serverStop(false)
+TcpServer::TcpServer(Selector *asl, SrvLogger *alg, FrameBus *fb, 
+                     PultQueue *pq, int fdSrv, const char *aLocalPath) 
+	                      : FdHandler(fdSrv, true), sel(asl), slg(alg), 
+	                        bus(fb), commands(pq), 
+	                        replies(std::make_unique<PultQueue>(asl, 
+	                                [this]() { DeliverReplies(); })),
+	                        sessions(le365const::tcp_session_pool), 
+	                        timers(le365const::timer_tick_msec), idleTicks(0),
+	                        keepaliveTicks(0), stallTicks(0), counters(),
+	                        cmdRate(0.0), cmdBurst(0.0), byteRate(0.0), 
+	                        byteBurst(0.0), localPath(aLocalPath), local(),
+	                        events(nullptr), source(0), profiler(nullptr),
+	                        acceptor(alg, "TCP-server", &counters),
+	                        serverStop(false)
 { 
-	asl->Add(&disp);
+	acceptor.OnShed([this](const char *why) { 
+		Event(ev_shed, 0, 0, 0, why); });
 	asl->Add(this);	
+	SetTimeouts(le365const::tcp_idle_timeout_sec, 
+	            le365const::tcp_keepalive_sec, 
+	            le365const::tcp_write_stall_sec);
+	SetRateLimits(le365const::tcp_cmd_rate, le365const::tcp_byte_rate);
 }
 
 TcpServer::~TcpServer()
 { 
 	sel->Remove(this);
-	close(GetFd());
+	local.reset();
+	if(!localPath.empty()) { unlink(localPath.c_str()); }
+	// The pool destroys the sessions:
+	sessions.ForEach([this](TcpSession *s) {
+		s->Unsubscribe();
+		timers.Cancel(s);
+		sel->Remove(s);
+	});
+	char logMsg[ 192 ];
+	snprintf(logMsg, sizeof(logMsg), 
+	         "TCP-server connections: accepted %llu, shed %llu, reset %llu, "
+	         "throttled %llu (commands %llu, input %llu)",
+	         static_cast<unsigned long long>(counters.accepted.load()),
+	         static_cast<unsigned long long>(counters.shed.load()),
+	         static_cast<unsigned long long>(counters.reset.load()),
+	         static_cast<unsigned long long>(counters.throttledSessions.load()),
+	         static_cast<unsigned long long>(counters.throttledCmds.load()),
+	         static_cast<unsigned long long>(counters.throttledBytes.load()));
+	slg->WriteLog(logMsg);
 }
 
 void TcpServer::Handle(bool r, [[maybe_unused]] bool w)
 {
 	if(!r) [[unlikely]] { return; }
-	sockaddr_in addr{};
-	socklen_t len{ sizeof(addr) };
-	int sd{ accept(GetFd(), reinterpret_cast<sockaddr*>(&addr), &len) };
-	if(sd == -1) [[unlikely]] { 
-		slg->WriteLog("TcpServerFault(Handle() in: accept())");
-		throw TcpServerFault("Handle() in: accept()"); 
+	Accept(GetFd());
+}
+
+void TcpServer::Accept(int ls)
+{
+	sockaddr_storage addr{};
+	for(int sd; (sd = acceptor.Next(ls, addr)) != -1; addr = {}) {
+		AddTcpSession(sd, addr);
+	}
+}
+
+void TcpServer::AddTcpSession(int sd, const sockaddr_storage &addr)
+{
+	if(!AcceptLoop::Watchable(sd)) [[unlikely]] {
+		acceptor.Drop(sd, "descriptor beyond FD_SETSIZE");
+		return;
+	}
+	uint64_t h{};
+	TcpSession *p{ nullptr };
+	try {
+		p = sessions.Create(h, this, sd);
+	} catch(const std::bad_alloc&) {
+		acceptor.Drop(sd, "out of memory");
+		return;
+	}
+	if(acceptor.Accepted()) {
+		Event(ev_accept_again, 0, 
+		      static_cast<uint32_t>(counters.shed.load()));
 	}
-	TcpSession *p = new TcpSession(this, sd, lcp);
+	p->id = h;
+	p->Rearm();                     // Needs the handle, see Rearm();
 	sel->Add(p);
-	p->networkDetails = inet_ntoa(addr.sin_addr);
-	p->networkDetails += ":";
-	p->networkDetails += std::to_string(ntohs(addr.sin_port));
-	std::string logMsg{ p->networkDetails + " has connected" };
-	slg->WriteLog(logMsg.c_str());
+	if(addr.ss_family == AF_INET) {
+		auto &in{ reinterpret_cast<const sockaddr_in&>(addr) };
+		snprintf(p->networkDetails, sizeof(p->networkDetails), "%s:%u", 
+		         inet_ntoa(in.sin_addr), ntohs(in.sin_port));
+		Event(ev_connect, h, in.sin_addr.s_addr, ntohs(in.sin_port));
+	} else {                        // A Unix peer has no name, the fd tells;
+		snprintf(p->networkDetails, sizeof(p->networkDetails), "local:%d", sd);
+		Event(ev_connect_local, h, static_cast<uint32_t>(sd));
+	}
+	slg->Log("%s has connected", p->networkDetails);
 }
 
 void TcpServer::RemoveTcpSession(TcpSession *s)
 { 
-	std::string logMsg{ s->networkDetails + " has disconnected" }; 
+	s->Unsubscribe();
+	timers.Cancel(s);
+	sessions.Release(s->id);
 	sel->Remove(s);	
-	int res{ 0 };
-	int fd{ s->GetFd() };
-	res = shutdown(fd, SHUT_RDWR);
-	if(res != 0) [[unlikely]] { 
-		slg->WriteLog("TcpServerFault(RemoveTcpSession() in: shutdown())");
-		throw TcpServerFault("RemoveTcpSession() in: shutdown()");
-	}
-	res = close(fd);
-	if(res != 0) [[unlikely]] {
-		slg->WriteLog("TcpServerFault(RemoveTcpSession() in: close()");
-		throw TcpServerFault("RemoveTcpSession() in: close()"); 
+	// The descriptor is closed once, by ~FdHandler() in GarbCollect(): 
+	// a second close() could hit a socket just accepted by another shard.
+	// A peer that has reset the connection fails it, that is no fault:
+	if(shutdown(s->GetFd(), SHUT_RDWR) != 0) [[unlikely]] { s->reset = true; }
+	if(s->reset) { counters.reset.fetch_add(1, std::memory_order_relaxed); }
+	Event(ev_disconnect, s->id, s->reset, static_cast<uint32_t>(s->throttled));
+	// Deferred: the line is formatted on the logger's thread, not here:
+	if(s->throttled) {
+		slg->Log("%s has disconnected%s, throttled %llu times", 
+		         s->networkDetails, s->reset ? " (reset)" : "", s->throttled);
+	} else {
+		slg->Log("%s has disconnected%s", 
+		         s->networkDetails, s->reset ? " (reset)" : "");
 	}
-	garblist.push_back(s);
-	slg->WriteLog(logMsg.c_str());
 }
 
 void TcpServer::GarbCollect()
 {
-    auto iter = garblist.begin();
-    while(iter != garblist.end()) {      
-		delete *iter; // Delete session object.
-        iter = garblist.erase(iter); // Erase std::list item and go to next.
-    }
+	// Destroys the released sessions, nothing to do most of the time:
+	sessions.Collect();
+}
+
+bool TcpServer::PostCommand(const PultCommand &c, bool timed)
+{
+	PultCommand cmd{ c };
+	cmd.replyTo = replies.get();
+	cmd.source = src_network;
+	cmd.stampNs = Timer::NowNs();
+	cmd.timed = timed;
+	return commands && commands->Post(cmd);
+}
+
+void TcpServer::DeliverReplies()
+{
+	// The session may have gone while its command was in flight:
+	PultCommand c{};
+	while(replies->Take(c)) {
+		if(TcpSession *s{ sessions.Get(c.origin) }; s) { s->PultDone(c); }
+	}
+}
+
+void TcpServer::SetTimeouts(double idleSec, double keepaliveSec, 
+                            double stallSec)
+{
+	auto ticks{ [this](double sec) { 
+		return sec > 0.0 ? timers.Ticks(sec) : uint64_t{ 0 }; 
+	} };
+	idleTicks = ticks(idleSec);
+	keepaliveTicks = ticks(keepaliveSec);
+	stallTicks = ticks(stallSec);
+}
+
+void TcpServer::SetRateLimits(double cmdPerSec, double bytesPerSec)
+{
+	cmdRate = std::max(cmdPerSec, 0.0);
+	cmdBurst = cmdRate * le365const::tcp_cmd_burst / le365const::tcp_cmd_rate;
+	byteRate = std::max(bytesPerSec, 0.0);
+	byteBurst = byteRate * le365const::tcp_byte_burst / 
+	            le365const::tcp_byte_rate;
+}
 
+void TcpServer::SetEventLog(EventLog *el, uint16_t aSource)
+{
+	events = el;
+	source = aSource;
 }
 
 void TcpServer::ServerStep()
 {
-    sel->Select();
+	// The wait ends in time for the next session timer:
+	sel->Select(timers.WaitUsec(le365const::select_delay_sec * 1000000 + 
+	                            le365const::select_delay_usec));
+	timers.Advance();
     GarbCollect();
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+
+LocalListener::LocalListener(Selector *sp, TcpServer *am, int fd, 
+                             const char *aPath)
+	: FdHandler(fd, true), sel(sp), master(am), path(aPath)
+{
+	sel->Add(this);
+}
+
+LocalListener::~LocalListener()
+{
+	sel->Remove(this);
+	unlink(path.c_str());
+}
+
+void LocalListener::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	master->Accept(GetFd());
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+NetworkThread::NetworkThread(TcpServer *sp)
+	: srv(sp), stop(false), running(true), fault(), thr()
+{
+	thr = std::thread([this]() { Run(); });
+	pthread_setname_np(thr.native_handle(), "le365-net");
+}
+
+NetworkThread::~NetworkThread()
+{
+	stop = true;
+	if(thr.joinable()) { thr.join(); }
+}
+
+void NetworkThread::Run()
+{
+	try {
+		while(!stop.load(std::memory_order_relaxed) && srv->ServerReady()) {
+			srv->ServerStep();
+		}
+	} catch(...) {
+		fault = std::current_exception();
+	}
+	running = false;
+}
+
+void NetworkThread::Join()
+{
+	stop = true;
+	if(thr.joinable()) { thr.join(); }
+	if(fault) { std::rethrow_exception(std::exchange(fault, nullptr)); }
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void TcpSession::Halt()
@@ -186,68 +668,501 @@ void TcpSession::Halt()
 	master->RemoveTcpSession(this);	
 }
 
+bool TcpSession::Live() const
+{
+	return master->sessions.Get(id) == this;
+}
+
+void TcpSession::Pause(double sec, bool forCommands)
+{
+	// Stops reading for "sec", the kernel's buffers fill and TCP slows
+	// the client down, nothing is lost and other clients go on:
+	TcpCounters &c{ master->counters };
+	(forCommands ? c.throttledCmds : c.throttledBytes)
+		.fetch_add(1, std::memory_order_relaxed);
+	if(throttled++ == 0) {
+		c.throttledSessions.fetch_add(1, std::memory_order_relaxed);
+		master->slg->Log("%s is throttled: over the %s rate", 
+		                 networkDetails, forCommands ? "command" : "input");
+		master->Event(ev_throttled, id, forCommands);
+	}
+	uint64_t until{ master->timers.Now() + master->timers.Ticks(sec) };
+	pausedUntil = paused ? std::max(pausedUntil, until) : until;
+	paused = true;
+	Rearm();
+}
+
 void TcpSession::Say(const char *msg)
 {
-	write(GetFd(), msg, strlen(msg));
-}
-
-TcpSession::TcpSession(TcpServer *am, int fd, LEDCore *cp) 
-	: FdHandler(fd, true), bufUsed(0), ignoring(false), master(am), cpi(),
-        handleMap{
-                    { le365const::client_exit.data(),
-                        [this]() { this->ServerAnswer("Bye!");      
-                                   this->Halt(); }},
-                    { le365const::client_mode_1.data(),
-                        [this]() { this->ServerAnswer("Mode=1");
-                                   this->cpi.Mode(mode_1); }},
-                    { le365const::client_mode_2.data(),
-                        [this]() { this->ServerAnswer("Mode=2");
-                                   this->cpi.Mode(mode_2); }},
-                    { le365const::client_mode_3.data(),
-                        [this]() { this->ServerAnswer("Mode=3");
-                                   this->cpi.Mode(mode_3); }},
-                    { le365const::client_mode_4.data(),
-                        [this]() { this->ServerAnswer("Mode=4");
-                                   this->cpi.Mode(mode_4); }},
-                    { le365const::client_mode_5.data(),
-                        [this]() { this->ServerAnswer("Mode=5");
-                                   this->cpi.Mode(mode_5); }},
-                    { le365const::client_mode_6.data(),
-                        [this]() { this->ServerAnswer("Mode=6");    
-                                   this->cpi.Mode(mode_6); }},
-                    { le365const::client_mode_7.data(),
-                        [this]() { this->ServerAnswer("Mode=7");
-                                   this->cpi.Mode(mode_7); }},
-                    { le365const::client_mode_8.data(),
-                        [this]() { this->ServerAnswer("Mode=8");
-                                   this->cpi.Mode(mode_8); }},
-                    { le365const::client_mode_9.data(),
-                        [this]() { this->ServerAnswer("Mode=9");
-                                   this->cpi.Mode(mode_9); }},
-                    { le365const::client_up.data(),
-                        [this]() { this->ServerAnswer("Up");
-                                   this->cpi.Up(); }},
-                    { le365const::client_down.data(),
-                        [this]() { this->ServerAnswer("Down");   
-                                   this->cpi.Down(); }},
-                    { le365const::client_right.data(),
-                        [this]() { this->ServerAnswer("Right");     
-                                   this->cpi.Right(); }},
-                    { le365const::client_left.data(),
-                        [this]() { this->ServerAnswer("Left");      
-                                   this->cpi.Left(); }},
-                    { le365const::client_ok.data(),
-                        [this]() { this->ServerAnswer("Ok");
-                                   this->cpi.Ok(); }}
-                 }
+	Send(msg, strlen(msg));
+}
+
+void TcpSession::Send(const char *data, size_t len)
+{
+	if(outBuf.empty()) {
+		ssize_t n{ send(GetFd(), data, len, MSG_NOSIGNAL) };
+		if(n < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				reset = true;
+				return; // The peer has gone, the read side will notice it;
+			}
+			n = 0;
+		}
+		data += n;
+		len -= static_cast<size_t>(n);
+	}
+	lastSent = master->timers.Now();
+	if(len == 0) { return; }
+	// The Selector flushes the rest when the socket is writable:
+	if(outBuf.empty()) {
+		stallSince = lastSent;
+		outBuf.append(data, len);
+		Rearm();
+	} else {
+		outBuf.append(data, len);
+	}
+}
+
+void TcpSession::Flush()
+{
+	if(outBuf.empty()) { return; }
+	ssize_t n{ send(GetFd(), outBuf.data(), outBuf.size(), MSG_NOSIGNAL) };
+	if(n < 0) {
+		if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			reset = true;
+			outBuf.clear();
+		}
+		return;
+	}
+	if(n > 0) { stallSince = master->timers.Now(); }
+	outBuf.erase(0, static_cast<size_t>(n));
+	// A slow subscriber gets the newest frame, not the skipped ones:
+	if(outBuf.empty() && subscribed && subBehind) {
+		FrameBus *bus{ master->GetBus() };
+		if(bus->CurrentSize() > 0) {
+			SendFrame(bus->Current(), bus->CurrentSize(), bus->CurrentInfo());
+		}
+	}
+}
+
+void TcpSession::Subscribe(const char *args)
+{
+	FrameBus *bus{ master->GetBus() };
+	if(!bus) {
+		ServerAnswer("Subscription is not available");
+		return;
+	}
+	// "subscribe [fps]", 0 is every presented frame:
+	double fps{ le365const::subscribe_default_fps };
+	if(args && *args) {
+		char *end{ nullptr };
+		fps = strtod(args, &end);
+		if(end == args || fps < 0.0 || !std::isfinite(fps)) {
+			ServerAnswer("Usage: subscribe [fps]");
+			return;
+		}
+	}
+	subInterval = fps > 0.0 ? 1.0 / fps : 0.0;
+	subBehind = false;
+	subPrev.clear();
+	subSinceKey = 0;
+	subscribed = true;
+	bus->Subscribe(this);
+	ServerAnswer("Subscribed");
+}
+
+void TcpSession::Unsubscribe()
+{
+	if(!subscribed) { return; }
+	subscribed = false;
+	subPrev.clear();
+	master->GetBus()->Unsubscribe(this);
+}
+
+void TcpSession::Pult(enum_pult_cmd cmd, enum_mode m)
+{
+	Pult(PultCommand{ cmd, m, nullptr, id });
+}
+
+void TcpSession::Pult(const PultCommand &c)
+{
+	// Answered by PultDone() when the render loop has applied it:
+	if(!master->PostCommand(c, timed)) {
+		ServerAnswer("Busy, the command is dropped");
+	}
+}
+
+void TcpSession::PultDone(const PultCommand &c)
+{
+	std::string msg{};
+	switch(c.cmd) {
+		case pult_mode:     msg = "Mode=" + std::to_string(c.mode);   break;
+		case pult_up:       msg = "Up";                               break;
+		case pult_down:     msg = "Down";                             break;
+		case pult_right:    msg = "Right";                            break;
+		case pult_left:     msg = "Left";                             break;
+		case pult_ok:       msg = "Ok";                               break;
+		case pult_bright:   msg = "Bright=" + std::to_string(c.value); break;
+		case pult_frame:    msg = "Frame";                            break;
+		case pult_commit:   msg = "Commit";                           break;
+		case pult_trace_start:
+		case pult_trace_stop:  TraceDone(c);                          return;
+		default:                                                      return;
+	}
+	// From the arrival to the end of the next frame's Show(), microseconds:
+	if(c.timed) {
+		msg += c.latencyNs ? " latency_us=" + 
+		                     std::to_string(c.latencyNs / 1000) : 
+		                     " latency_us=none";
+	}
+	ServerAnswer(msg.c_str());
+}
+
+void TcpSession::Latency(const char *args)
+{
+	// "latency [on | off]", the acknowledgement of a pult command waits
+	// for the frame and tells its latency:
+	std::string_view arg{ args ? args : "" };
+	if(arg == "on" || arg == "off") {
+		timed = (arg == "on");
+	} else if(!arg.empty()) {
+		ServerAnswer("Usage: latency [on | off]");
+		return;
+	}
+	ServerAnswer(timed ? "Latency is on" : "Latency is off");
+}
+
+void TcpSession::Draw(DrawFn f, const char *args, const char *usage)
+{
+	if(!args || !f(canvas.data(), args)) {
+		ServerAnswer(usage);
+		return;
+	}
+	if(!inBatch) { PostCanvas(pult_frame, -1); }
+}
+
+void TcpSession::Bright(const char *args)
+{
+	// "bri level", absolute, 0..max_bright:
+	int b{};
+	if(!args || !ParseInt(args, le365const::min_bright, 
+	                      le365const::max_bright, b) || !AtEnd(args)) {
+		ServerAnswer("Usage: bri level");
+		return;
+	}
+	if(inBatch) { batchBright = b; }
+	else {
+		PultCommand c{ pult_bright, mode_null, nullptr, id };
+		c.value = b;
+		Pult(c);
+	}
+}
+
+void TcpSession::Begin()
+{
+	if(inBatch) {
+		ServerAnswer("Already in a batch");
+		return;
+	}
+	inBatch = true;
+	batchBright = -1;
+	ServerAnswer("Begin");
+}
+
+void TcpSession::Commit()
+{
+	if(!inBatch) {
+		ServerAnswer("No batch to commit");
+		return;
+	}
+	inBatch = false;
+	PostCanvas(pult_commit, batchBright);
+}
+
+void TcpSession::PostCanvas(enum_pult_cmd cmd, int bright)
+{
+	PultCommand c{ cmd, mode_null, nullptr, id };
+	c.value = bright;
+	c.frame = canvas;
+	Pult(c);
+}
+
+// Queries are served from the network thread's copy of the presented
+// frame (see FrameBus), the render thread is not involved:
+void TcpSession::QueryStatus()
+{
+	FrameBus *bus{ master->GetBus() };
+	if(!bus) {
+		ServerAnswer("Status is not available");
+		return;
+	}
+	const FrameInfo &info{ bus->CurrentInfo() };
+	if(info.counter == 0) {
+		ServerAnswer("frame=0, nothing presented yet");
+		return;
+	}
+	char msg[ 128 ];
+	snprintf(msg, sizeof(msg), "mode=%d bright=%d fps=%.1f frame=%llu", 
+	         info.mode, info.bright, bus->Fps(), 
+	         static_cast<unsigned long long>(info.counter));
+	ServerAnswer(msg);
+}
+
+void TcpSession::QueryFrame(const char *args)
+{
+	FrameBus *bus{ master->GetBus() };
+	if(!bus) {
+		ServerAnswer("Frame is not available");
+		return;
+	}
+	// "frame [hex|bin]", "bin" is a keyframe record as in a subscription:
+	std::string_view form{ args ? args : "" };
+	if(form == "bin") {
+		std::string rec{};
+		encode_keyframe(rec, bus->Current(), bus->CurrentSize(), 
+		                bus->CurrentInfo().counter);
+		Send(rec.data(), rec.size());
+		return;
+	}
+	if(!form.empty() && form != "hex") {
+		ServerAnswer("Usage: frame [hex|bin]");
+		return;
+	}
+	static constexpr char digits[]{ "0123456789abcdef" };
+	char msg[ le365const::tcp_line_max_length + 1 ];
+	int n{ snprintf(msg, sizeof(msg), "frame=%llu ", 
+	                static_cast<unsigned long long>(bus->CurrentInfo().counter)) };
+	auto at{ static_cast<size_t>(n) };
+	size_t bytes{ bus->CurrentSize() * sizeof(CRGB) };
+	// A line with "SRV: " and its end; never a cut frame:
+	if(at + bytes * 2 + 5 + le365const::server_new_line.size() > 
+	   le365const::tcp_line_max_length) {
+		ServerAnswer("Frame is too long for a line, use: frame bin");
+		return;
+	}
+	auto p{ reinterpret_cast<const uint8_t*>(bus->Current()) };
+	for(size_t i = 0; i < bytes; ++i) {
+		msg[at++] = digits[p[i] >> 4];
+		msg[at++] = digits[p[i] & 0x0f];
+	}
+	msg[at] = 0;
+	ServerAnswer(msg);
+}
+
+void TcpSession::QueryHash()
+{
+	FrameBus *bus{ master->GetBus() };
+	if(!bus) {
+		ServerAnswer("Hash is not available");
+		return;
+	}
+	char msg[ 64 ];
+	snprintf(msg, sizeof(msg), "hash=%016llx frame=%llu", 
+	         static_cast<unsigned long long>(
+	             frame_hash(bus->Current(), bus->CurrentSize())),
+	         static_cast<unsigned long long>(bus->CurrentInfo().counter));
+	ServerAnswer(msg);
+}
+
+void TcpSession::QueryStats(const char *args)
+{
+	FrameProfiler *prof{ master->profiler };
+	if(!prof) {
+		ServerAnswer("Stats are not available (built with PROFILE=0)");
+		return;
+	}
+	// "stats [reset | perf on|off]", the render thread clears them and
+	// opens the counters on its next turn:
+	std::string_view arg{ args ? args : "" };
+	if(arg == "reset") {
+		prof->AskReset();
+		ServerAnswer("Stats reset");
+		return;
+	}
+	if(arg == "perf on" || arg == "perf off") {
+		prof->AskPerf(arg == "perf on");
+		ServerAnswer(arg == "perf on" ? 
+		             "Perf counters on, they follow the timings" : 
+		             "Perf counters off");
+		return;
+	}
+	if(!arg.empty()) {
+		ServerAnswer("Usage: stats [reset | perf on|off]");
+		return;
+	}
+	// A table of lines, answered at once:
+	std::string msg{};
+	prof->Report(msg, "SRV: ");
+	msg.pop_back();
+	msg += le365const::server_new_line;
+	Send(msg.data(), msg.size());
+}
+
+void TcpSession::QueryTrace(const char *args)
+{
+	FrameProfiler *prof{ master->profiler };
+	if(!prof) {
+		ServerAnswer("Trace is not available (built with PROFILE=0)");
+		return;
+	}
+	// "trace [start | stop]", the file is set on the command line only, a
+	// client must not choose what the emulator overwrites:
+	FrameTracer &tracer{ prof->Tracer() };
+	std::string_view arg{ args ? args : "" };
+	if(arg.empty()) {
+		ServerAnswer(tracer.Active() ? "Trace is on" : "Trace is off");
+	} else if(arg == "start" || arg == "stop") {
+		// The render loop starts and writes it, answered by PultDone():
+		Pult(arg == "start" ? pult_trace_start : pult_trace_stop);
+	} else {
+		ServerAnswer("Usage: trace [start | stop]");
+	}
+}
+
+void TcpSession::TraceDone(const PultCommand &c)
+{
+	const std::string &file{ master->profiler->Tracer().Path() };
+	char msg[ le365const::tcp_line_max_length ];
+	if(c.value < 0) {
+		snprintf(msg, sizeof(msg), "Trace not %s: %s, %s", 
+		         c.cmd == pult_trace_start ? "started" : "written", 
+		         file.c_str(), strerror(-c.value));
+	} else if(c.cmd == pult_trace_start) {
+		snprintf(msg, sizeof(msg), "Trace started");
+	} else {
+		snprintf(msg, sizeof(msg), "Trace written: %s, %d events", 
+		         file.c_str(), c.value);
+		master->slg->Log("Trace written: %s", file.c_str());
+	}
+	ServerAnswer(msg);
+}
+
+void TcpSession::OnBusFrame(const CRGB *leds, size_t count, 
+                            const FrameInfo &info)
+{
+	if(subInterval > 0.0 && subTimer.Elapsed() < subInterval) { return; }
+	if(!outBuf.empty()) {
+		subBehind = true; // Don't queue up, send the newest one later;
+		return;
+	}
+	SendFrame(leds, count, info);
+}
+
+void TcpSession::SendFrame(const CRGB *leds, size_t count, 
+                           const FrameInfo &info)
+{
+	std::string rec{};
+	bool key{ subPrev.size() != count || 
+	          subSinceKey >= le365const::subscribe_key_interval };
+	if(key) {
+		encode_keyframe(rec, leds, count, info.counter);
+		subSinceKey = 0;
+	} else {
+		encode_delta(rec, leds, subPrev.data(), count, info.counter);
+		++subSinceKey;
+	}
+	subPrev.assign(leds, leds + count);
+	lastActive = master->timers.Now();
+	subBehind = false;
+	subTimer.Reset();
+	Send(rec.data(), rec.size());
+}
+
+// One table for all the sessions, a new session allocates nothing for it:
+const std::unordered_map<std::string_view, CommandEntry> 
+TcpSession::handleMap{
+    { le365const::client_exit, { cmd_bare,
+        [](TcpSession &s, const char*) { s.ServerAnswer("Bye!");
+                                         s.Halt(); } }},
+    { le365const::client_mode_1, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_1); } }},
+    { le365const::client_mode_2, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_2); } }},
+    { le365const::client_mode_3, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_3); } }},
+    { le365const::client_mode_4, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_4); } }},
+    { le365const::client_mode_5, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_5); } }},
+    { le365const::client_mode_6, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_6); } }},
+    { le365const::client_mode_7, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_7); } }},
+    { le365const::client_mode_8, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_8); } }},
+    { le365const::client_mode_9, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_mode, mode_9); } }},
+    { le365const::client_up, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_up); } }},
+    { le365const::client_down, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_down); } }},
+    { le365const::client_right, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_right); } }},
+    { le365const::client_left, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_left); } }},
+    { le365const::client_ok, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Pult(pult_ok); } }},
+    { le365const::client_subscribe, { cmd_args,
+        [](TcpSession &s, const char *args) { s.Subscribe(args); } }},
+    { le365const::client_unsubscribe, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Unsubscribe();
+                                         s.ServerAnswer("Unsubscribed"); } }},
+    { le365const::client_px, { cmd_args,
+        [](TcpSession &s, const char *args) { 
+            s.Draw(DrawPixel, args, "Usage: px index RRGGBB"); } }},
+    { le365const::client_range, { cmd_args,
+        [](TcpSession &s, const char *args) { 
+            s.Draw(DrawRange, args, "Usage: range from to RRGGBB"); } }},
+    { le365const::client_fill, { cmd_args,
+        [](TcpSession &s, const char *args) { 
+            s.Draw(DrawFill, args, "Usage: fill RRGGBB"); } }},
+    { le365const::client_grad, { cmd_args,
+        [](TcpSession &s, const char *args) { 
+            s.Draw(DrawGradient, args, 
+                   "Usage: grad from to RRGGBB RRGGBB"); } }},
+    { le365const::client_pal, { cmd_args,
+        [](TcpSession &s, const char *args) { 
+            s.Draw(DrawPalette, args, 
+                   "Usage: pal from to RRGGBB RRGGBB [... 16 colors]"); } }},
+    { le365const::client_bri, { cmd_args,
+        [](TcpSession &s, const char *args) { s.Bright(args); } }},
+    { le365const::client_begin, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Begin(); } }},
+    { le365const::client_commit, { cmd_bare,
+        [](TcpSession &s, const char*) { s.Commit(); } }},
+    { le365const::client_status, { cmd_bare,
+        [](TcpSession &s, const char*) { s.QueryStatus(); } }},
+    { le365const::client_frame, { cmd_args,
+        [](TcpSession &s, const char *args) { s.QueryFrame(args); } }},
+    { le365const::client_hash, { cmd_bare,
+        [](TcpSession &s, const char*) { s.QueryHash(); } }},
+    { le365const::client_stats, { cmd_args,
+        [](TcpSession &s, const char *args) { s.QueryStats(args); } }},
+    { le365const::client_trace, { cmd_args,
+        [](TcpSession &s, const char *args) { s.QueryTrace(args); } }},
+    { le365const::client_latency, { cmd_args,
+        [](TcpSession &s, const char *args) { s.Latency(args); } }}
+};
+
+TcpSession::TcpSession(TcpServer *am, int fd) 
+	: FdHandler(fd, true), buffer(), bufUsed(0), ignoring(false), 
+	  networkDetails(), master(am), id(0),
+        subscribed(false), subBehind(false), subInterval(0.0), subTimer(),
+        subPrev(), subSinceKey(0), lastActive(am->timers.Now()), 
+        lastSent(lastActive), stallSince(lastActive), reset(false),
+        cmdBucket(am->cmdRate, am->cmdBurst, am->timers.NowSec()),
+        byteBucket(am->byteRate, am->byteBurst, am->timers.NowSec()),
+        paused(false), pausedUntil(0), throttled(0), canvas(), 
+        inBatch(false), batchBright(-1), timed(false)
 { 
-	cpi.Init(cp);
 	Say(le365const::server_welcome.data()); 
 }
 
-void TcpSession::Handle(bool r, [[maybe_unused]] bool w)
+void TcpSession::Handle(bool r, bool w)
 {
-	if(!r) [[unlikely]] { return; }
+	if(w) { Flush(); }
+	if(!r) { return; }
+	lastActive = master->timers.Now();
 	if(bufUsed >= static_cast<int>(sizeof(buffer))) {
 		bufUsed = 0;
 		ignoring = true;
@@ -259,8 +1174,13 @@ void TcpSession::Handle(bool r, [[maybe_unused]] bool w)
 void TcpSession::ReadAndIgnore()
 {
 	int r = read(GetFd(), buffer, sizeof(buffer));
+	if(r < 0 && (errno == EAGAIN || errno == EINTR)) { return; }
+	if(r < 0) { reset = true; }
 	if(r < 1) { Halt(); } 
 	else {
+		if(!byteBucket.Take(r, master->timers.NowSec())) {
+			Pause(byteBucket.Wait(0.0), false);
+		}
 		for(int i = 0; i < r; ++i) {
 			if(buffer[i] == '\n') { // Stop ignoring.
 				int rest{ r - i - 1 };
@@ -270,6 +1190,7 @@ void TcpSession::ReadAndIgnore()
 				bufUsed = rest;
 				ignoring = false;
 				CheckLines();
+				break;
 			}
 		}
 	}
@@ -279,9 +1200,14 @@ void TcpSession::ReadAndCheck()
 {
 	int r = read(GetFd(), buffer + bufUsed, 
 	             sizeof(buffer) - static_cast<size_t>(bufUsed));
+	if(r < 0 && (errno == EAGAIN || errno == EINTR)) { return; }
+	if(r < 0) { reset = true; }
 	if(r < 1) { Halt(); }
 	else {
 		bufUsed += r;
+		if(!byteBucket.Take(r, master->timers.NowSec())) {
+			Pause(byteBucket.Wait(0.0), false);
+		}
 		CheckLines();
 	}	
 }
@@ -292,9 +1218,17 @@ void TcpSession::CheckLines()
 	int i{};
 	for(i = 0; i < bufUsed; ++i) {
 		if(buffer[i] == '\n') {
+			// Over the rate the line stays in the buffer for later:
+			if(!(inBatch && FreeInBatch(std::string_view(buffer, 
+			                                static_cast<size_t>(i)))) && 
+			   !cmdBucket.TryTake(1.0, master->timers.NowSec())) {
+				Pause(cmdBucket.Wait(1.0), true);
+				return;
+			}
 			buffer[i] = 0;
 			if(i > 0 && buffer[i-1] == '\r') { buffer[i-1] = 0; }
 			ProcessLine(buffer);
+			if(!Live()) { return; }                 // Quit or an error;
 			int rest{ bufUsed - 1 - i };
 			if(rest < 0) { return; }				// This check is need ???!!!
 			memmove(buffer, buffer + i + 1, static_cast<size_t>(rest));
@@ -307,8 +1241,24 @@ void TcpSession::CheckLines()
 
 void TcpSession::ProcessLine(const char *str)
 {
-	if(auto f{ handleMap.find(str) }; f != handleMap.end()) { 
-	    f->second(); 
+	master->Event(ev_command, id, 0, 0, str);
+	// "command [arguments]":
+	const char *args{ strchr(str, ' ') };
+	std::string_view cmd{ args ? std::string_view(str, args) : 
+	                             std::string_view(str) };
+	if(args) { while(*args == ' ') { ++args; } }
+	if(auto f{ handleMap.find(cmd) }; f != handleMap.end()) { 
+	    // "m1 junk" is not "m1", a typo must not act:
+	    if(f->second.args == cmd_bare && args && *args) {
+	        std::string usage{ "Usage: " };
+	        usage += cmd;
+	        ServerAnswer(usage.c_str());
+	        return;
+	    }
+	    // The keys are literals, null-terminated, the session is the arg:
+	    LE365_TRACE_SCOPE(master->profiler, f->first.data(), 
+	                      static_cast<int64_t>(id));
+	    f->second.fn(*this, args); 
 	} else { 
 	    ServerAnswer("Unrecognized command");
 	}
@@ -316,13 +1266,61 @@ void TcpSession::ProcessLine(const char *str)
 
 void TcpSession::ServerAnswer(const char *str)
 {
-	const char *srvStr{ le365const::server_new_line.data() };
-	int lenSrvStr{ static_cast<int>(strlen(srvStr)) };
-	int lenStr{ static_cast<int>(strlen(str)) };
-	char *msg = new char[lenStr + lenSrvStr];
-	sprintf(msg, "SRV: %s%s", str, srvStr);
-	Say(msg);
-	delete[] msg;
+	char msg[ le365const::tcp_line_max_length + 1 ];
+	int n{ snprintf(msg, sizeof(msg), "SRV: %s%s", str, 
+	                le365const::server_new_line.data()) };
+	Send(msg, std::min(static_cast<size_t>(n), sizeof(msg) - 1));
+}
+
+void TcpSession::OnTimer()
+{
+	const TcpServer &m{ *master };
+	uint64_t now{ m.timers.Now() };
+	if(m.stallTicks && !outBuf.empty() && now - stallSince >= m.stallTicks) {
+		master->slg->Log("%s write stall", networkDetails);
+		master->Event(ev_stall, id);
+		// Reset, the kernel would keep trickling the backlog to the peer:
+		linger lg{ 1, 0 };
+		setsockopt(GetFd(), SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+		Halt();
+		return;
+	}
+	if(m.idleTicks && now - lastActive >= m.idleTicks) {
+		ServerAnswer("Idle timeout, bye!");
+		Halt();
+		return;
+	}
+	if(paused && now >= pausedUntil) {
+		paused = false;
+		CheckLines();
+		if(!Live()) { return; }
+	}
+	// A subscriber's stream is its keepalive, text would break it:
+	if(m.keepaliveTicks && !subscribed && now - lastSent >= m.keepaliveTicks) {
+		ServerAnswer("Keepalive");
+	}
+	Rearm();
+}
+
+void TcpSession::Rearm()
+{
+	if(!Live()) { return; }         // A released session must stay unlinked;
+	const TcpServer &m{ *master };
+	uint64_t due{ UINT64_MAX };
+	if(paused) { due = pausedUntil; }
+	if(m.idleTicks) { due = std::min(due, lastActive + m.idleTicks); }
+	if(m.keepaliveTicks) { due = std::min(due, lastSent + m.keepaliveTicks); }
+	if(m.stallTicks && !outBuf.empty()) { 
+		due = std::min(due, stallSince + m.stallTicks); 
+	}
+	if(due == UINT64_MAX) {
+		master->timers.Cancel(this);
+		return;
+	}
+	// An earlier timer will look again, activity does not touch the wheel:
+	if(Armed() && Expire() <= due) { return; }
+	uint64_t now{ m.timers.Now() };
+	master->timers.Schedule(this, due > now ? due - now : 1);
 }
 
 
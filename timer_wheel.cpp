@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    IMPLEMENTATION:
+    Hierarchical timer wheel of a reactor thread
+                                                ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+TimerWheel::TimerWheel(int tickMsec)
+    : wheel(), start(clock_t::now()), tickUsec(tickMsec * 1000), now(0),
+      armed(0)
+{
+    for(auto &level : wheel) {
+        for(auto &slot : level) { slot.prev = slot.next = &slot; }
+    }
+}
+
+uint64_t TimerWheel::Ticks(double sec) const
+{
+    double t{ std::ceil(sec * 1e6 / tickUsec) };
+    return t < 1.0 ? 1 : static_cast<uint64_t>(t);
+}
+
+void TimerWheel::Unlink(WheelLink *l)
+{
+    l->prev->next = l->next;
+    l->next->prev = l->prev;
+    l->prev = l->next = nullptr;
+}
+
+void TimerWheel::Place(WheelTimer *t)
+{
+    // The lowest level whose span covers the timer; a timer beyond the
+    // top level goes round it again, Fire() puts it back in place:
+    uint64_t delta{ t->expire - now };
+    int level{ 0 };
+    while(level < num_levels - 1 &&
+          delta >= num_slots << (level * level_bits)) { ++level; }
+    WheelLink &slot{ wheel[static_cast<size_t>(level)]
+                          [(t->expire >> (level * level_bits)) & slot_mask] };
+    WheelLink *l{ t };
+    l->prev = slot.prev;
+    l->next = &slot;
+    slot.prev->next = l;
+    slot.prev = l;
+}
+
+void TimerWheel::Schedule(WheelTimer *t, uint64_t ticks)
+{
+    Cancel(t);
+    t->expire = now + std::max<uint64_t>(ticks, 1);
+    Place(t);
+    ++armed;
+}
+
+void TimerWheel::Cancel(WheelTimer *t)
+{
+    if(!t->Armed()) { return; }
+    Unlink(t);
+    --armed;
+}
+
+void TimerWheel::Cascade(int level)
+{
+    WheelLink &slot{ wheel[static_cast<size_t>(level)]
+                          [(now >> (level * level_bits)) & slot_mask] };
+    if(slot.next == &slot) { return; }
+    // Detach the list first, a far timer may land in the same slot again:
+    WheelLink batch{};
+    batch.next = slot.next;
+    batch.prev = slot.prev;
+    batch.next->prev = batch.prev->next = &batch;
+    slot.prev = slot.next = &slot;
+    while(batch.next != &batch) {
+        auto t{ static_cast<WheelTimer*>(batch.next) };
+        Unlink(t);
+        Place(t);
+    }
+}
+
+void TimerWheel::Fire(WheelLink &slot)
+{
+    // A callback may schedule and cancel any timer, this one included:
+    while(slot.next != &slot) {
+        auto t{ static_cast<WheelTimer*>(slot.next) };
+        Unlink(t);
+        if(t->expire > now) {
+            Place(t);
+            continue;
+        }
+        --armed;
+        t->OnTimer();
+    }
+}
+
+void TimerWheel::Advance()
+{
+    auto elapsed{ std::chrono::duration_cast<std::chrono::microseconds>(
+                      clock_t::now() - start).count() };
+    uint64_t target{ static_cast<uint64_t>(elapsed / tickUsec) };
+    while(now < target) {
+        if(!armed) {                         // Nothing to cascade or fire;
+            now = target;
+            break;
+        }
+        ++now;
+        for(int level = num_levels - 1; level > 0; --level) {
+            uint64_t lower{ (uint64_t{ 1 } << (level * level_bits)) - 1 };
+            if((now & lower) == 0) { Cascade(level); }
+        }
+        Fire(wheel[0][now & slot_mask]);
+    }
+}
+
+int TimerWheel::WaitUsec(int cap) const
+{
+    if(!armed) { return cap; }
+    // The next occupied slot of level 0, else the next cascade:
+    uint64_t ahead{ num_slots - (now & slot_mask) };
+    for(uint64_t j = 1; j < ahead; ++j) {
+        const WheelLink &slot{ wheel[0][(now + j) & slot_mask] };
+        if(slot.next != &slot) {
+            ahead = j;
+            break;
+        }
+    }
+    auto elapsed{ std::chrono::duration_cast<std::chrono::microseconds>(
+                      clock_t::now() - start).count() };
+    auto wait{ static_cast<int64_t>(now + ahead) * tickUsec - elapsed };
+    return static_cast<int>(std::clamp<int64_t>(wait, 0, cap));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,308 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     IMPLEMENTATION:
+     UDP frame ingestion: E1.31 (sACN), Art-Net and DDP
+                                                        ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "udp_ingest.h"
+
+#include <sys/timerfd.h>
+
+#include <algorithm>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Wire formats ///////////////////////////////////////////////////////////////
+
+namespace {
+
+uint16_t get_be16(const uint8_t *p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t get_be32(const uint8_t *p)
+{
+    return (uint32_t{ p[0] } << 24) | (uint32_t{ p[1] } << 16) |
+           (uint32_t{ p[2] } << 8)  |  uint32_t{ p[3] };
+}
+
+// E1.31 (ANSI E1.31-2018), offsets from the start of the datagram:
+constexpr uint8_t e131_acn_id[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1',
+                                      '7', 0, 0, 0 };
+constexpr size_t e131_acn_id_pos{ 4 };
+constexpr size_t e131_root_vector_pos{ 18 };
+constexpr size_t e131_frame_vector_pos{ 40 };
+constexpr size_t e131_sync_addr_pos{ 109 };         // Data packet;
+constexpr size_t e131_options_pos{ 112 };
+constexpr size_t e131_universe_pos{ 113 };
+constexpr size_t e131_prop_count_pos{ 123 };
+constexpr size_t e131_start_code_pos{ 125 };
+constexpr size_t e131_data_pos{ 126 };
+constexpr size_t e131_sync_universe_pos{ 45 };      // Sync packet;
+constexpr size_t e131_sync_len{ 49 };
+constexpr uint32_t e131_vector_root_data{ 0x00000004 };
+constexpr uint32_t e131_vector_root_extended{ 0x00000008 };
+constexpr uint32_t e131_vector_frame_data{ 0x00000002 };
+constexpr uint32_t e131_vector_frame_sync{ 0x00000001 };
+constexpr uint8_t e131_option_preview{ 0x80 };
+
+// Art-Net 4, little-endian opcodes:
+constexpr uint8_t artnet_id[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0 };
+constexpr uint16_t artnet_op_dmx{ 0x5000 };
+constexpr uint16_t artnet_op_sync{ 0x5200 };
+constexpr size_t artnet_opcode_pos{ 8 };
+constexpr size_t artnet_subuni_pos{ 14 };
+constexpr size_t artnet_net_pos{ 15 };
+constexpr size_t artnet_length_pos{ 16 };
+constexpr size_t artnet_data_pos{ 18 };
+
+// DDP (Distributed Display Protocol):
+constexpr uint8_t ddp_flag_version_mask{ 0xC0 };
+constexpr uint8_t ddp_flag_version_1{ 0x40 };
+constexpr uint8_t ddp_flag_timecode{ 0x10 };
+constexpr uint8_t ddp_flag_query{ 0x02 };
+constexpr uint8_t ddp_flag_push{ 0x01 };
+constexpr size_t ddp_offset_pos{ 4 };
+constexpr size_t ddp_length_pos{ 8 };
+constexpr size_t ddp_header_len{ 10 };
+constexpr size_t ddp_timecode_len{ 4 };
+
+constexpr size_t bytes_per_universe{ le365const::udp_leds_per_universe * 3 };
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+UdpIngest* UdpIngest::Start(Selector *sel, LEDCore *cp, SrvLogger *slg,
+                            enum_udp_proto pr, int port)
+{
+	int us{ socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0) };
+	if(us == -1) [[unlikely]] {
+		slg->WriteLog("TcpServerFault(UdpIngest::Start() in: socket())");
+	    throw TcpServerFault("UdpIngest::Start() in: socket()");
+	}
+	// No SO_REUSEADDR: on UDP it lets a second receiver split the
+	// datagrams silently, a taken port must fail the start instead.
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(static_cast<uint16_t>(port));
+	int res{ bind(us, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) };
+	if(res == -1) [[unlikely]] {
+		close(us);
+	    slg->WriteLog("TcpServerFault(UdpIngest::Start() in: bind())");
+	    throw TcpServerFault("UdpIngest::Start() in: bind()");
+	}
+	return new UdpIngest(sel, cp, slg, pr, us);
+}
+
+UdpIngest::UdpIngest(Selector *asl, LEDCore *cp, SrvLogger *alg,
+                     enum_udp_proto pr, int fdUdp)
+	: FdHandler(fdUdp, true), sel(asl), slg(alg), lcp(cp), proto(pr),
+	  buffers(le365const::udp_batch_size * le365const::udp_datagram_max),
+	  msgs(le365const::udp_batch_size), iovs(le365const::udp_batch_size),
+	  pending(false), artSynced(false), artSyncTimer(), e131Sync(0),
+	  syncLost(false), presentTimer(this, timerfd_create(CLOCK_MONOTONIC, 
+	                                    TFD_NONBLOCK | TFD_CLOEXEC))
+{
+	if(presentTimer.GetFd() == -1) [[unlikely]] {
+		slg->WriteLog("TcpServerFault(UdpIngest() in: timerfd_create())");
+		throw TcpServerFault("UdpIngest() in: timerfd_create()");
+	}
+	for(size_t i = 0; i < msgs.size(); ++i) {
+		iovs[i].iov_base = buffers.data() + i * le365const::udp_datagram_max;
+		iovs[i].iov_len = le365const::udp_datagram_max;
+		msgs[i].msg_hdr = msghdr{};
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	asl->Add(this);
+	asl->Add(&presentTimer);
+}
+
+UdpIngest::~UdpIngest()
+{
+	sel->Remove(&presentTimer);
+	sel->Remove(this);
+}
+
+void UdpIngest::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	// Drain the socket, many datagrams per system call:
+	for(int b = 0; b < le365const::udp_batches_per_wakeup; ++b) {
+		int n{ recvmmsg(GetFd(), msgs.data(),
+		                static_cast<unsigned>(msgs.size()), MSG_DONTWAIT, 0) };
+		if(n <= 0) { break; }
+		for(size_t i = 0; i < static_cast<size_t>(n); ++i) {
+			Dispatch(static_cast<const uint8_t*>(iovs[i].iov_base),
+			         msgs[i].msg_len);
+		}
+		if(n < static_cast<int>(msgs.size())) { break; }
+	}
+	// Unsynchronized senders: one frame per wakeup.
+	if(pending) {
+		bool waitSync{ (proto == udp_e131 && e131Sync != 0) ||
+		               (proto == udp_artnet && artSynced) ||
+		               proto == udp_ddp };
+		if(!waitSync || syncLost) { Present(); }
+	}
+}
+
+void UdpIngest::Dispatch(const uint8_t *p, size_t len)
+{
+	switch(proto) {
+		case udp_e131:      DecodeE131(p, len);     break;
+		case udp_artnet:    DecodeArtNet(p, len);   break;
+		case udp_ddp:       DecodeDdp(p, len);      break;
+		default:                                    break;
+	}
+}
+
+void UdpIngest::DecodeE131(const uint8_t *p, size_t len)
+{
+	if(len < e131_sync_len ||
+	   memcmp(p + e131_acn_id_pos, e131_acn_id, sizeof(e131_acn_id)) != 0) {
+		return;
+	}
+	uint32_t rootVector{ get_be32(p + e131_root_vector_pos) };
+	uint32_t frameVector{ get_be32(p + e131_frame_vector_pos) };
+	if(rootVector == e131_vector_root_extended &&
+	   frameVector == e131_vector_frame_sync) {
+		if(pending && get_be16(p + e131_sync_universe_pos) == e131Sync) {
+			Synced();
+			Present();
+		}
+		return;
+	}
+	if(rootVector != e131_vector_root_data ||
+	   frameVector != e131_vector_frame_data || len < e131_data_pos) {
+		return;
+	}
+	if(p[e131_options_pos] & e131_option_preview) { return; }
+	if(p[e131_start_code_pos] != 0) { return; }  // Not a dimmer data;
+	int universe{ get_be16(p + e131_universe_pos) -
+	              le365const::udp_e131_first_universe };
+	if(universe < 0) { return; }
+	size_t slots{ get_be16(p + e131_prop_count_pos) };
+	if(slots < 1) { return; }
+	slots = std::min({ slots - 1, len - e131_data_pos, bytes_per_universe });
+	e131Sync = get_be16(p + e131_sync_addr_pos);
+	WritePixels(static_cast<size_t>(universe) * bytes_per_universe,
+	            p + e131_data_pos, slots);
+}
+
+void UdpIngest::DecodeArtNet(const uint8_t *p, size_t len)
+{
+	if(len < artnet_data_pos ||
+	   memcmp(p, artnet_id, sizeof(artnet_id)) != 0) {
+		return;
+	}
+	uint16_t opcode{ static_cast<uint16_t>(p[artnet_opcode_pos] |
+	                                       (p[artnet_opcode_pos + 1] << 8)) };
+	if(artSynced &&
+	   artSyncTimer.Elapsed() >= le365const::udp_artsync_timeout_sec) {
+		artSynced = false;
+	}
+	if(opcode == artnet_op_sync) {
+		artSynced = true;
+		artSyncTimer.Reset();
+		Synced();
+		if(pending) { Present(); }
+		return;
+	}
+	if(opcode != artnet_op_dmx) { return; }
+	int universe{ ((p[artnet_net_pos] & 0x7F) << 8 | p[artnet_subuni_pos]) -
+	              le365const::udp_artnet_first_universe };
+	if(universe < 0) { return; }
+	size_t slots{ std::min({ size_t{ get_be16(p + artnet_length_pos) },
+	                         len - artnet_data_pos, bytes_per_universe }) };
+	WritePixels(static_cast<size_t>(universe) * bytes_per_universe,
+	            p + artnet_data_pos, slots);
+}
+
+void UdpIngest::DecodeDdp(const uint8_t *p, size_t len)
+{
+	if(len < ddp_header_len) { return; }
+	uint8_t flags{ p[0] };
+	if((flags & ddp_flag_version_mask) != ddp_flag_version_1) { return; }
+	if(flags & ddp_flag_query) { return; }
+	size_t dataPos{ ddp_header_len };
+	if(flags & ddp_flag_timecode) { dataPos += ddp_timecode_len; }
+	if(len < dataPos) { return; }
+	size_t count{ std::min(size_t{ get_be16(p + ddp_length_pos) },
+	                       len - dataPos) };
+	WritePixels(get_be32(p + ddp_offset_pos), p + dataPos, count);
+	if(flags & ddp_flag_push) { Synced(); }
+	if((flags & ddp_flag_push) && pending) { Present(); }
+}
+
+void UdpIngest::WritePixels(size_t offset, const uint8_t *data, size_t len)
+{
+	size_t fbSize{ lcp->GetLiveBufferSize() };
+	if(len == 0 || offset >= fbSize) { return; }
+	len = std::min(len, fbSize - offset);
+	// Every write keeps the pattern off, the live timer may have expired
+	// while the frame waited:
+	lcp->BeginLiveFrame();
+	memcpy(lcp->GetLiveBuffer() + offset, data, len);
+	if(!pending) { presentTimer.Arm(le365const::udp_present_timeout_sec); }
+	pending = true;
+}
+
+void UdpIngest::Present()
+{
+	pending = false;
+	presentTimer.Disarm();
+	lcp->CommitLiveFrame();
+}
+
+void UdpIngest::Synced()
+{
+	if(!syncLost) { return; }
+	syncLost = false;
+	slg->WriteLog("UDP ingestion: synchronized frames again");
+}
+
+void UdpIngest::SyncTimeout()
+{
+	// The sync source or the push has stopped: the frame is shown as is,
+	// the next ones once per wakeup until a sync comes again:
+	if(!pending) { return; }
+	if(!syncLost) {
+		syncLost = true;
+		slg->WriteLog("UDP ingestion: no sync for a frame, showing as they "
+		              "come");
+	}
+	Present();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+void UdpPresentTimer::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	uint64_t expirations{};
+	[[maybe_unused]] ssize_t n{ read(GetFd(), &expirations, 
+	                                 sizeof(expirations)) };
+	master->SyncTimeout();
+}
+
+void UdpPresentTimer::Arm(double sec)
+{
+	itimerspec its{};
+	its.it_value.tv_sec = static_cast<time_t>(sec);
+	its.it_value.tv_nsec = static_cast<long>((sec - 
+	                       static_cast<double>(its.it_value.tv_sec)) * 1e9);
+	timerfd_settime(GetFd(), 0, &its, nullptr);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+    Benchmark of the WebSocket viewers: reactor CPU per broadcast and
+    share of the render thread for many viewers of a long strip
+    (headless, loopback, viewers decode and verify the frames)
+                                                              ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "frame_bus.h"
+#include "fastled_port.h"
+#include "tcp_srv.h"
+#include "ws_srv.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+double thread_cpu_sec()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + ts.tv_nsec * 1e-9;
+}
+
+// A browser stand-in: WebSocket client decoding the frame records.
+struct Viewer {
+    int fd{ -1 };
+    std::string in{};
+    std::vector<uint8_t> rgb{};
+    size_t bytes{ 0 };
+    size_t frames{ 0 };
+    bool bad{ false };
+};
+
+int connect_viewer(int port)
+{
+    int s{ socket(AF_INET, SOCK_STREAM, 0) };
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if(connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(s);
+        return -1;
+    }
+    // The sample handshake of RFC 6455:
+    const char req[]{ "GET /ws HTTP/1.1\r\nHost: localhost\r\n"
+                      "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                      "Sec-WebSocket-Version: 13\r\n\r\n" };
+    [[maybe_unused]] ssize_t n{ write(s, req, sizeof(req) - 1) };
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+    return s;
+}
+
+size_t get_varint(const uint8_t *&p)
+{
+    size_t v{ 0 };
+    int shift{ 0 };
+    uint8_t b{};
+    do {
+        b = *p++;
+        v |= size_t{ b & 0x7Fu } << shift;
+        shift += 7;
+    } while(b & 0x80);
+    return v;
+}
+
+void apply_record(Viewer &v, const uint8_t *p, size_t len)
+{
+    if(len < le365frame::header_size || p[0] != le365frame::frame_magic) {
+        v.bad = true;
+        return;
+    }
+    const uint8_t *data{ p + le365frame::header_size };
+    const uint8_t *end{ p + len };
+    if(p[1] == le365frame::frame_key) {
+        v.rgb.assign(data, end);
+    } else {
+        size_t i{ 0 };
+        while(data < end) {
+            i += get_varint(data);
+            size_t take{ get_varint(data) };
+            if((i + take) * 3 > v.rgb.size()) {
+                v.bad = true;
+                return;
+            }
+            std::copy(data, data + take * 3, v.rgb.begin() +
+                      static_cast<std::ptrdiff_t>(i * 3));
+            data += take * 3;
+            i += take;
+        }
+    }
+    ++v.frames;
+}
+
+void parse(Viewer &v)
+{
+    if(v.frames == 0 && v.in.starts_with("HTTP/1.1")) {
+        size_t end{ v.in.find("\r\n\r\n") };
+        if(end == std::string::npos) { return; }
+        if(v.in.find("101 Switching") == std::string::npos ||
+           v.in.find("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == std::string::npos) {
+            v.bad = true;
+        }
+        v.in.erase(0, end + 4);
+    }
+    size_t pos{ 0 };
+    while(v.in.size() - pos >= 2) {
+        auto p{ reinterpret_cast<const uint8_t*>(v.in.data() + pos) };
+        size_t len{ p[1] & 0x7Fu };
+        size_t hdr{ 2 };
+        if(len == 126) {
+            if(v.in.size() - pos < 4) { break; }
+            len = size_t{ p[2] } << 8 | p[3];
+            hdr = 4;
+        } else if(len == 127) {
+            if(v.in.size() - pos < 10) { break; }
+            len = 0;
+            for(size_t i = 2; i < 10; ++i) { len = len << 8 | p[i]; }
+            hdr = 10;
+        }
+        if(v.in.size() - pos < hdr + len) { break; }
+        if((p[0] & 0x0F) == 0x02) { apply_record(v, p + hdr, len); }
+        pos += hdr + len;
+    }
+    v.in.erase(0, pos);
+}
+
+void drain(std::vector<Viewer> &viewers, std::atomic<bool> &stop)
+{
+    std::vector<pollfd> pfds;
+    for(auto &v : viewers) { pfds.push_back(pollfd{ v.fd, POLLIN, 0 }); }
+    char buf[65536];
+    while(!stop.load()) {
+        if(poll(pfds.data(), pfds.size(), 20) <= 0) { continue; }
+        for(size_t i = 0; i < pfds.size(); ++i) {
+            if(!(pfds[i].revents & POLLIN)) { continue; }
+            ssize_t n{};
+            while((n = read(pfds[i].fd, buf, sizeof(buf))) > 0) {
+                viewers[i].in.append(buf, static_cast<size_t>(n));
+                viewers[i].bytes += static_cast<size_t>(n);
+            }
+            parse(viewers[i]);
+        }
+    }
+}
+
+// Full: every LED changes each frame; sparse: a single LED moves.
+void render(std::vector<CRGB> &leds, bool full, int frame)
+{
+    if(full) {
+        fill_rainbow(leds.data(), static_cast<int>(leds.size()),
+                     static_cast<uint8_t>(frame), 1);
+    } else {
+        fill_solid(leds.data(), static_cast<int>(leds.size()), CRGB::Black);
+        leds[static_cast<size_t>(frame) % leds.size()] = CRGB::White;
+    }
+}
+
+void run(SrvLogger &logger, int numViewers, size_t numLeds, bool full,
+         int port)
+{
+    const int fps{ 60 };
+    const int frames{ 180 };
+    Selector selector(&logger);
+    FrameBus bus(&selector);
+    std::unique_ptr<WsServer> ws{ WsServer::Start(&selector, &logger,
+                                                  &bus, port) };
+    std::vector<Viewer> viewers(static_cast<size_t>(numViewers));
+    for(auto &v : viewers) {
+        v.fd = connect_viewer(port);
+        selector.Select();              // Accept;
+    }
+    while(ws->Viewers() < viewers.size()) { selector.Select(); }
+
+    std::atomic<bool> stop{ false };
+    std::thread client(drain, std::ref(viewers), std::ref(stop));
+    std::vector<CRGB> leds(numLeds);
+    FrameInfo info{};
+    double cpu{ 0.0 };
+    auto tick{ std::chrono::steady_clock::now() };
+    auto start{ tick };
+    for(int f = 0; f < frames; ++f) {
+        render(leds, full, f);
+        double t0{ thread_cpu_sec() };
+        info.counter = static_cast<uint64_t>(f + 1);
+        bus.OnFrame(leds.data(), leds.size(), info);
+        selector.Select();
+        cpu += thread_cpu_sec() - t0;
+        tick += std::chrono::microseconds(1000000 / fps);
+        std::this_thread::sleep_until(tick);
+    }
+    double wall{ std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start).count() };
+    // The last frame must reach every viewer intact:
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    render(leds, full, frames);
+    bus.OnFrame(leds.data(), leds.size(), info);
+    for(int i = 0; i < 20; ++i) {
+        double t0{ thread_cpu_sec() };
+        selector.Select();
+        cpu += thread_cpu_sec() - t0;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    stop = true;
+    client.join();
+
+    size_t bytes{ 0 }, got{ 0 }, intact{ 0 };
+    for(auto &v : viewers) {
+        bytes += v.bytes;
+        got += v.frames;
+        if(!v.bad && v.rgb.size() == numLeds * 3 &&
+           memcmp(v.rgb.data(), leds.data(), v.rgb.size()) == 0) {
+            ++intact;
+        }
+        close(v.fd);
+    }
+    double broadcasts{ static_cast<double>(got) / numViewers };
+    printf("%3d viewers x %6zu LEDs, %-6s: %5.1f frames/s/viewer, "
+           "%8.1f KiB/s/viewer, reactor %7.1f us/broadcast, "
+           "%5.2f%% of the render thread, %d/%d intact\n",
+           numViewers, numLeds, full ? "full" : "sparse", broadcasts / wall,
+           static_cast<double>(bytes) / numViewers / wall / 1024,
+           cpu * 1e6 / broadcasts, cpu / wall * 100,
+           static_cast<int>(intact), numViewers);
+    for(int i = 0; i < 4; ++i) { selector.Select(); }
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+    // Connects are logged to std::clog, the results go to std::cout:
+    SrvLogger logger("/dev/null");
+    int port{ 42000 };
+    for(size_t leds : { size_t{ 75 }, size_t{ 10000 } }) {
+        run(logger, 50, leds, true, port++);
+        run(logger, 50, leds, false, port++);
+    }
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,581 @@
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+     IMPLEMENTATION:
+     HTTP/WebSocket endpoint for the browser viewers
+                                                    ***/
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ws_srv.h"
+#include "frame_bus.h"
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <new>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Protocol helpers ///////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr std::string_view ws_guid{ "258EAFA5-E914-47DA-95CA-C5AB0DC85B11" };
+constexpr std::string_view ws_path{ "/ws" };
+
+constexpr uint8_t ws_fin{ 0x80 };
+constexpr uint8_t ws_op_mask{ 0x0F };
+constexpr uint8_t ws_op_binary{ 0x02 };
+constexpr uint8_t ws_op_close{ 0x08 };
+constexpr uint8_t ws_op_ping{ 0x09 };
+constexpr uint8_t ws_op_pong{ 0x0A };
+constexpr uint8_t ws_masked{ 0x80 };
+constexpr uint8_t ws_len_mask{ 0x7F };
+constexpr uint8_t ws_len_16{ 126 };
+constexpr uint8_t ws_len_64{ 127 };
+
+// The viewer draws one canvas pixel per LED and decodes the frame records
+// of frame_bus.h (0xFE, 'K' keyframe or 'D' LEB128 skip/take delta).
+constexpr std::string_view viewer_page{ R"PAGE(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>LedsEmulator365</title>
+<style>
+body{background:#111;color:#aaa;font:14px sans-serif;margin:16px}
+canvas{image-rendering:pixelated;background:#000;margin-top:8px}
+</style></head><body>
+<div id="st">Connecting...</div><canvas id="cv" width="1" height="1"></canvas>
+<script>
+const st=document.getElementById('st'),cv=document.getElementById('cv');
+const g=cv.getContext('2d');let px=null,img=null,cols=0;
+function paint(n){
+  if(!img||img.width*img.height<n||cols*img.height<n){
+    cols=n<=75?15:Math.ceil(Math.sqrt(n*2));
+    const rows=Math.ceil(n/cols),sz=Math.max(2,Math.floor(900/cols));
+    cv.width=cols;cv.height=rows;cv.style.width=cols*sz+'px';
+    cv.style.height=rows*sz+'px';img=g.createImageData(cols,rows);
+  }
+  const d=img.data;
+  for(let i=0;i<n;i++){d[4*i]=px[3*i];d[4*i+1]=px[3*i+1];
+    d[4*i+2]=px[3*i+2];d[4*i+3]=255;}
+  g.putImageData(img,0,0);
+}
+function open(){
+  const ws=new WebSocket('ws://'+location.host+'/ws');
+  ws.binaryType='arraybuffer';
+  ws.onopen=()=>{st.textContent='Connected';};
+  ws.onclose=()=>{st.textContent='Disconnected, retrying...';
+                  setTimeout(open,1000);};
+  ws.onmessage=(e)=>{
+    const b=new Uint8Array(e.data),v=new DataView(e.data);
+    if(b.length<12||b[0]!=0xFE)return;
+    const cnt=v.getUint32(4),end=12+v.getUint32(8);
+    if(b[1]==75){px=b.slice(12,end);}
+    else if(b[1]==68&&px){
+      let p=12,i=0;
+      const num=()=>{let x=0,s=0,y;
+        do{y=b[p++];x+=(y&127)*Math.pow(2,s);s+=7;}while(y&128);return x;};
+      while(p<end){i+=num();const t=num();
+        px.set(b.subarray(p,p+3*t),3*i);p+=3*t;i+=t;}
+    }else return;
+    paint(px.length/3);
+    st.textContent='Frame '+cnt+', '+px.length/3+' LEDs';
+  };
+}
+open();
+</script></body></html>
+)PAGE" };
+
+uint32_t rol32(uint32_t v, int n)
+{
+	return (v << n) | (v >> (32 - n));
+}
+
+std::array<uint8_t, 20> sha1(std::string_view data)
+{
+	uint32_t h[5]{ 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+	               0xC3D2E1F0 };
+	std::string m{ data };
+	uint64_t bits{ uint64_t{ data.size() } * 8 };
+	m.push_back(static_cast<char>(0x80));
+	while(m.size() % 64 != 56) { m.push_back(0); }
+	for(int i = 7; i >= 0; --i) {
+		m.push_back(static_cast<char>(bits >> (8 * i)));
+	}
+	for(size_t off = 0; off < m.size(); off += 64) {
+		uint32_t w[80];
+		auto p{ reinterpret_cast<const uint8_t*>(m.data() + off) };
+		for(size_t i = 0; i < 16; ++i) {
+			w[i] = (uint32_t{ p[4 * i] } << 24) |
+			       (uint32_t{ p[4 * i + 1] } << 16) |
+			       (uint32_t{ p[4 * i + 2] } << 8) | uint32_t{ p[4 * i + 3] };
+		}
+		for(size_t i = 16; i < 80; ++i) {
+			w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+		uint32_t a{ h[0] }, b{ h[1] }, c{ h[2] }, d{ h[3] }, e{ h[4] };
+		for(size_t i = 0; i < 80; ++i) {
+			uint32_t f{}, k{};
+			if(i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+			else if(i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+			else if(i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+			else            { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+			uint32_t t{ rol32(a, 5) + f + e + k + w[i] };
+			e = d;
+			d = c;
+			c = rol32(b, 30);
+			b = a;
+			a = t;
+		}
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+	}
+	std::array<uint8_t, 20> out{};
+	for(size_t i = 0; i < 20; ++i) {
+		out[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+	}
+	return out;
+}
+
+std::string base64(const uint8_t *p, size_t len)
+{
+	static constexpr char abc[]{
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+	std::string out{};
+	for(size_t i = 0; i < len; i += 3) {
+		uint32_t v{ uint32_t{ p[i] } << 16 };
+		if(i + 1 < len) { v |= uint32_t{ p[i + 1] } << 8; }
+		if(i + 2 < len) { v |= p[i + 2]; }
+		out.push_back(abc[(v >> 18) & 0x3F]);
+		out.push_back(abc[(v >> 12) & 0x3F]);
+		out.push_back(i + 1 < len ? abc[(v >> 6) & 0x3F] : '=');
+		out.push_back(i + 2 < len ? abc[v & 0x3F] : '=');
+	}
+	return out;
+}
+
+// Server frames are never masked:
+void put_frame_header(std::string &out, uint8_t opcode, size_t len)
+{
+	out.push_back(static_cast<char>(ws_fin | opcode));
+	if(len < ws_len_16) {
+		out.push_back(static_cast<char>(len));
+	} else if(len <= 0xFFFF) {
+		out.push_back(static_cast<char>(ws_len_16));
+		out.push_back(static_cast<char>(len >> 8));
+		out.push_back(static_cast<char>(len));
+	} else {
+		out.push_back(static_cast<char>(ws_len_64));
+		for(int i = 7; i >= 0; --i) {
+			out.push_back(static_cast<char>(uint64_t{ len } >> (8 * i)));
+		}
+	}
+}
+
+WsMessage make_frame(uint8_t opcode, std::string_view payload)
+{
+	auto msg{ std::make_shared<std::string>() };
+	msg->reserve(payload.size() + 10);
+	put_frame_header(*msg, opcode, payload.size());
+	msg->append(payload);
+	return msg;
+}
+
+std::string lower(std::string_view s)
+{
+	std::string out{ s };
+	for(auto &c : out) {
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	}
+	return out;
+}
+
+std::string_view trim(std::string_view s)
+{
+	while(!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+		s.remove_prefix(1);
+	}
+	while(!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+		s.remove_suffix(1);
+	}
+	return s;
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// WsServer ///////////////////////////////////////////////////////////////////
+
+WsServer* WsServer::Start(Selector *sel, SrvLogger *slg, FrameBus *fb, int port)
+{
+	// Non-blocking: Handle() accepts until the queue is empty.
+	int ls{ socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0) };
+	if(ls == -1) [[unlikely]] {
+		slg->WriteLog("TcpServerFault(WsServer::Start() in: socket())");
+	    throw TcpServerFault("WsServer::Start() in: socket()");
+	}
+	int opt { 1 };
+	setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(static_cast<uint16_t>(port));
+	int res{ bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) };
+	if(res == -1) [[unlikely]] {
+		close(ls);
+	    slg->WriteLog("TcpServerFault(WsServer::Start() in: bind())");
+	    throw TcpServerFault("WsServer::Start() in: bind()");
+	}
+	res = listen(ls, le365const::tcp_qlen_for_listen);
+	if(res == -1) [[unlikely]] {
+		close(ls);
+	    slg->WriteLog("TcpServerFault(WsServer::Start() in: listen())");
+	    throw TcpServerFault("WsServer::Start() in: listen()");
+	}
+	return new WsServer(sel, slg, fb, ls);
+}
+
+WsServer::WsServer(Selector *asl, SrvLogger *alg, FrameBus *fb, int fdSrv)
+	: FdHandler(fdSrv, true), sel(asl), slg(alg), bus(fb), sessions(),
+	  garblist(), viewers(0), frameTimer(), frameDue(0.0), seq(0), frame(), prevFrame(),
+	  counter(0), keyMsg(), deltaMsg(), counters(),
+	  acceptor(alg, "WebSocket server", &counters)
+{
+	asl->Add(this);
+	bus->Subscribe(this);
+}
+
+WsServer::~WsServer()
+{
+	bus->Unsubscribe(this);
+	sel->Remove(this);
+	for(auto s : sessions) {
+		sel->Remove(s);
+		delete s;
+	}
+	GarbCollect();
+}
+
+void WsServer::Handle(bool r, [[maybe_unused]] bool w)
+{
+	if(!r) [[unlikely]] { return; }
+	GarbCollect();
+	sockaddr_storage addr{};
+	for(int sd; (sd = acceptor.Next(GetFd(), addr)) != -1; addr = {}) {
+		if(!AcceptLoop::Watchable(sd)) [[unlikely]] {
+			acceptor.Drop(sd, "descriptor beyond FD_SETSIZE");
+			continue;
+		}
+		WsSession *p{ nullptr };
+		try {
+			p = new WsSession(this, sd);
+		} catch(const std::bad_alloc&) {
+			acceptor.Drop(sd, "out of memory");
+			continue;
+		}
+		acceptor.Accepted();
+		sel->Add(p);
+		sessions.push_back(p);
+		auto &in{ reinterpret_cast<const sockaddr_in&>(addr) };
+		p->networkDetails = inet_ntoa(in.sin_addr);
+		p->networkDetails += ":";
+		p->networkDetails += std::to_string(ntohs(in.sin_port));
+	}
+}
+
+void WsServer::RemoveWsSession(WsSession *s)
+{
+	sel->Remove(s);
+	// The descriptor itself is closed by ~FdHandler() in GarbCollect():
+	shutdown(s->GetFd(), SHUT_RDWR);
+	sessions.remove(s);
+	garblist.push_back(s);
+	if(s->viewer) {
+		--viewers;
+		std::string logMsg{ s->networkDetails + " viewer has disconnected" };
+		slg->WriteLog(logMsg.c_str());
+	}
+}
+
+void WsServer::GarbCollect()
+{
+    auto iter = garblist.begin();
+    while(iter != garblist.end()) {
+		delete *iter; // Delete session object.
+        iter = garblist.erase(iter); // Erase std::list item and go to next.
+    }
+}
+
+void WsServer::OnBusFrame(const CRGB *leds, size_t count,
+                          const FrameInfo &info)
+{
+	GarbCollect();
+	if(viewers == 0) { return; }
+	// Broadcast on a fixed schedule, so 60 FPS renders give 30 FPS exactly:
+	const double interval{ 1.0 / le365const::ws_max_fps };
+	double now{ frameTimer.Elapsed() };
+	if(now < frameDue) { return; }
+	frameDue = std::max(frameDue + interval, now);
+	prevFrame.swap(frame);
+	frame.assign(leds, leds + count);
+	counter = info.counter;
+	++seq;
+	keyMsg.reset();
+	deltaMsg.reset();
+	for(auto s : sessions) { s->SendCurrent(); }
+}
+
+WsMessage WsServer::KeyFrame()
+{
+	if(!keyMsg) {
+		std::string rec{};
+		encode_keyframe(rec, frame.data(), frame.size(), counter);
+		keyMsg = make_frame(ws_op_binary, rec);
+	}
+	return keyMsg;
+}
+
+WsMessage WsServer::Delta()
+{
+	if(seq % le365const::ws_key_interval == 0 ||
+	   prevFrame.size() != frame.size()) {
+		return KeyFrame();
+	}
+	if(!deltaMsg) {
+		std::string rec{};
+		encode_delta(rec, frame.data(), prevFrame.data(), frame.size(),
+		             counter);
+		deltaMsg = make_frame(ws_op_binary, rec);
+	}
+	return deltaMsg;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// WsSession //////////////////////////////////////////////////////////////////
+
+WsSession::WsSession(WsServer *am, int fd)
+	: FdHandler(fd, true), master(am), viewer(false), closing(false),
+	  halted(false), lastSeq(0)
+{}
+
+void WsSession::Halt()
+{
+	if(halted) { return; }
+	halted = true;
+	master->RemoveWsSession(this);
+}
+
+void WsSession::Send(WsMessage msg)
+{
+	size_t done{ 0 };
+	if(outQ.empty()) {
+		ssize_t n{ send(GetFd(), msg->data(), msg->size(), MSG_NOSIGNAL) };
+		if(n < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				return; // The peer has gone, the read side will notice it;
+			}
+			n = 0;
+		}
+		done = static_cast<size_t>(n);
+	}
+	if(done < msg->size()) {
+		outQ.push_back(Pending{ std::move(msg), done });
+	} else if(closing) {
+		Halt();
+	}
+}
+
+void WsSession::Flush()
+{
+	while(!outQ.empty()) {
+		Pending &p{ outQ.front() };
+		ssize_t n{ send(GetFd(), p.msg->data() + p.done,
+		                p.msg->size() - p.done, MSG_NOSIGNAL) };
+		if(n < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				outQ.clear();
+				Halt();
+			}
+			return;
+		}
+		p.done += static_cast<size_t>(n);
+		if(p.done < p.msg->size()) { return; }
+		outQ.pop_front();
+	}
+	if(closing) {
+		Halt();
+		return;
+	}
+	// A slow viewer gets the newest frame, not the skipped ones:
+	if(viewer && lastSeq != master->seq) { SendCurrent(); }
+}
+
+void WsSession::SendCurrent()
+{
+	if(!viewer || closing || master->seq == 0) { return; }
+	if(!outQ.empty()) { return; } // Busy, Flush() catches up later;
+	bool inSync{ lastSeq != 0 && lastSeq + 1 == master->seq };
+	lastSeq = master->seq;
+	Send(inSync ? master->Delta() : master->KeyFrame());
+}
+
+void WsSession::Handle(bool r, bool w)
+{
+	if(w) { Flush(); }
+	if(!r || halted) { return; }
+	char chunk[4096];
+	for(;;) {
+		ssize_t n{ read(GetFd(), chunk, sizeof(chunk)) };
+		if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { break; }
+		if(n < 0 && errno == EINTR) { continue; }
+		if(n < 1) {
+			Halt();
+			return;
+		}
+		inBuf.append(chunk, static_cast<size_t>(n));
+		if(inBuf.size() > static_cast<size_t>(le365const::ws_request_max)) {
+			Halt();
+			return;
+		}
+	}
+	if(closing) {
+		inBuf.clear();
+		return;
+	}
+	if(viewer) { ReadFrames(); }
+	else { ReadRequest(); }
+}
+
+void WsSession::ReadRequest()
+{
+	size_t end{ inBuf.find("\r\n\r\n") };
+	if(end == std::string::npos) { return; }
+	std::string_view head{ inBuf.data(), end };
+	// Request line: "GET /path HTTP/1.1"
+	size_t eol{ head.find("\r\n") };
+	std::string_view line{ head.substr(0, eol) };
+	size_t sp1{ line.find(' ') };
+	size_t sp2{ line.find(' ', sp1 == line.npos ? line.npos : sp1 + 1) };
+	if(sp1 == line.npos || sp2 == line.npos) {
+		Answer("400 Bad Request", "text/plain", "Bad request\n");
+		return;
+	}
+	std::string_view method{ line.substr(0, sp1) };
+	std::string_view path{ line.substr(sp1 + 1, sp2 - sp1 - 1) };
+	// Headers needed for the upgrade:
+	std::string upgrade{}, key{}, version{};
+	while(eol != head.npos) {
+		size_t next{ head.find("\r\n", eol + 2) };
+		std::string_view h{ head.substr(eol + 2, next == head.npos ?
+		                                head.npos : next - eol - 2) };
+		eol = next;
+		size_t colon{ h.find(':') };
+		if(colon == h.npos) { continue; }
+		std::string name{ lower(trim(h.substr(0, colon))) };
+		std::string_view value{ trim(h.substr(colon + 1)) };
+		if(name == "upgrade") { upgrade = lower(value); }
+		else if(name == "sec-websocket-key") { key = value; }
+		else if(name == "sec-websocket-version") { version = value; }
+	}
+	if(method != "GET") {
+		Answer("405 Method Not Allowed", "text/plain", "GET only\n");
+	} else if(path == ws_path) {
+		if(upgrade == "websocket" && !key.empty() && version == "13") {
+			inBuf.erase(0, end + 4);
+			Upgrade(key);
+		} else {
+			Answer("400 Bad Request", "text/plain",
+			       "WebSocket version 13 upgrade expected\n");
+		}
+	} else if(path == "/" || path == "/index.html") {
+		Answer("200 OK", "text/html; charset=utf-8", viewer_page);
+	} else {
+		Answer("404 Not Found", "text/plain", "Not found\n");
+	}
+}
+
+void WsSession::Answer(const char *status, const char *type,
+                       std::string_view body)
+{
+	auto msg{ std::make_shared<std::string>("HTTP/1.1 ") };
+	*msg += status;
+	*msg += "\r\nContent-Type: ";
+	*msg += type;
+	*msg += "\r\nContent-Length: " + std::to_string(body.size());
+	*msg += "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+	msg->append(body);
+	closing = true;
+	inBuf.clear();
+	Send(std::move(msg));
+}
+
+void WsSession::Upgrade(const std::string &key)
+{
+	std::string concat{ key };
+	concat += ws_guid;
+	auto digest{ sha1(concat) };
+	auto msg{ std::make_shared<std::string>(
+		"HTTP/1.1 101 Switching Protocols\r\n"
+		"Upgrade: websocket\r\nConnection: Upgrade\r\n"
+		"Sec-WebSocket-Accept: ") };
+	*msg += base64(digest.data(), digest.size());
+	*msg += "\r\n\r\n";
+	viewer = true;
+	++master->viewers;
+	std::string logMsg{ networkDetails + " viewer has connected" };
+	master->slg->WriteLog(logMsg.c_str());
+	Send(std::move(msg));
+	SendCurrent();
+	if(!inBuf.empty()) { ReadFrames(); }
+}
+
+void WsSession::ReadFrames()
+{
+	// Client frames are always masked, the viewer only needs the control ones:
+	while(inBuf.size() >= 2) {
+		auto p{ reinterpret_cast<const uint8_t*>(inBuf.data()) };
+		uint8_t opcode{ static_cast<uint8_t>(p[0] & ws_op_mask) };
+		uint64_t len{ static_cast<uint64_t>(p[1] & ws_len_mask) };
+		size_t pos{ 2 };
+		if(len == ws_len_16) {
+			if(inBuf.size() < 4) { return; }
+			len = (uint64_t{ p[2] } << 8) | p[3];
+			pos = 4;
+		} else if(len == ws_len_64) {
+			if(inBuf.size() < 10) { return; }
+			len = 0;
+			for(size_t i = 2; i < 10; ++i) { len = (len << 8) | p[i]; }
+			pos = 10;
+		}
+		if(!(p[1] & ws_masked) ||
+		   len > static_cast<uint64_t>(le365const::ws_request_max)) {
+			Halt();
+			return;
+		}
+		if(inBuf.size() < pos + 4 + len) { return; }
+		const uint8_t *mask{ p + pos };
+		pos += 4;
+		std::string payload(inBuf, pos, static_cast<size_t>(len));
+		for(size_t i = 0; i < payload.size(); ++i) {
+			payload[i] = static_cast<char>(payload[i] ^ mask[i % 4]);
+		}
+		inBuf.erase(0, pos + static_cast<size_t>(len));
+		if(opcode == ws_op_close) {
+			// Echo the status code and close when it has been sent:
+			closing = true;
+			Send(make_frame(ws_op_close,
+			                std::string_view(payload).substr(0, 2)));
+			return;
+		}
+		if(opcode == ws_op_ping) {
+			Send(make_frame(ws_op_pong, payload));
+		}
+		// Text, binary, continuation and pong frames are ignored.
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////